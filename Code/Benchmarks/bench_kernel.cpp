@@ -0,0 +1,209 @@
+#include <bits/stdc++.h>
+#include "../Common/packed_perm.h"
+#include "../Common/ist_rules.h"
+#include "../Common/dispatch_n.h"
+#include "../Common/rule_table.h"
+#include "../Common/batch_kernel.h"
+#include "../Common/gray_kernel.h"
+#include "../Common/ist_verify.h"
+using namespace std;
+
+// Tree-construction kernel benchmark: generic (runtime int n) vs the
+// FixedN<n> instantiation picked by dispatchN, and the branchy parent1 rules
+// vs the RuleTable lookup, and the RuleTable path vs batchParents (SIMD batch
+// with rank deltas), and batchParents vs grayParents (Gray-code walk with
+// O(1) updates). Each pass unranks every vertex, computes its
+// parent for all n-1 trees and re-ranks the parent. Before timing, the rule
+// table, the batch kernel and the Gray-code walk are checked against parent1
+// on every (vertex, tree) for n <= 10.
+
+template<class Dim>
+uint64_t buildKernel(Dim n, uint64_t N) {
+    uint64_t checksum = 0;
+    for (int t = 1; t <= n-1; ++t)
+        for (uint64_t vIdx = 1; vIdx < N; ++vIdx) {
+            PackedPerm v = unrankPacked(vIdx, n);
+            checksum += rankPacked(parent1(v, t, n), n);
+        }
+    return checksum;
+}
+
+template<class Dim>
+uint64_t buildKernelTable(const RuleTable& rules, Dim n, uint64_t N) {
+    uint64_t checksum = 0;
+    for (int t = 1; t <= n-1; ++t)
+        for (uint64_t vIdx = 1; vIdx < N; ++vIdx) {
+            PackedPerm v = unrankPacked(vIdx, n);
+            checksum += rankPacked(rules.parent(v, t, n), n);
+        }
+    return checksum;
+}
+
+template<class Dim>
+uint64_t buildKernelBatch(const RuleTable& rules, Dim n, uint64_t N) {
+    uint64_t checksum = 0;
+    uint8_t swapPos[PARENT_BATCH];
+    uint64_t parentRank[PARENT_BATCH];
+    for (int t = 1; t <= n-1; ++t)
+        for (uint64_t vBase = 0; vBase < N; vBase += PARENT_BATCH) {
+            int count = (int)min<uint64_t>(PARENT_BATCH, N - vBase);
+            batchParents(rules, t, n, vBase, count, nullptr, swapPos, parentRank);
+            for (int l = (vBase == 0 ? 1 : 0); l < count; ++l) checksum += parentRank[l];
+        }
+    return checksum;
+}
+
+template<class Dim>
+uint64_t buildKernelGray(const RuleTable& rules, Dim n, uint64_t N) {
+    uint64_t checksum = 0, B = grayBlockSize(n), rootIdx = rankPacked(PackedPerm::identity(n), n);
+    for (int t = 1; t <= n-1; ++t)
+        for (uint64_t lo = 0; lo < N; lo += B)
+            grayParents(rules, t, n, lo, lo + B, [&](uint64_t v, int, uint64_t p) { if (v != rootIdx) checksum += p; });
+    return checksum;
+}
+
+bool rulesAgree(const RuleTable& rules, int n) {
+    for (uint64_t vIdx = 1; vIdx < FACT[n]; ++vIdx) {
+        PackedPerm v = unrankPacked(vIdx, n);
+        for (int t = 1; t <= n-1; ++t)
+            if (parent1(v, t, n) != rules.tableParent(v, t, n)) {
+                cerr << "rule table disagrees with parent1: n=" << n
+                     << " v=" << vIdx << " t=" << t << "\n";
+                return false;
+            }
+    }
+    return true;
+}
+
+// batchParents against the scalar rules, vertex by vertex: the swap position
+// must give the parent and parentRank its rank. Checks the table path
+// (perms given) and the implicit path (perms == nullptr).
+bool batchAgrees(const RuleTable& rules, int n) {
+    const uint64_t N = FACT[n], rootIdx = rankPacked(PackedPerm::identity(n), n);
+    vector<PackedPerm> perms(N);
+    for (uint64_t vIdx = 0; vIdx < N; ++vIdx) perms[vIdx] = unrankPacked(vIdx, n);
+    uint8_t swapPos[PARENT_BATCH];
+    uint64_t parentRank[PARENT_BATCH];
+    for (int implicit = 0; implicit < 2; ++implicit)
+        for (int t = 1; t <= n-1; ++t)
+            for (uint64_t vBase = 0; vBase < N; vBase += PARENT_BATCH) {
+                int count = (int)min<uint64_t>(PARENT_BATCH, N - vBase);
+                batchParents(rules, t, n, vBase, count, implicit ? nullptr : perms.data() + vBase, swapPos, parentRank);
+                for (int l = 0; l < count; ++l) {
+                    uint64_t vIdx = vBase + l;
+                    if (vIdx == rootIdx) continue;
+                    PackedPerm p = rules.parent(perms[vIdx], t, n);
+                    if (swapPos[l] >= n-1 || perms[vIdx].swapped(swapPos[l]) != p || parentRank[l] != rankPacked(p, n)) {
+                        cerr << "batch kernel disagrees with the rules (" << (implicit ? "implicit" : "table")
+                             << "): n=" << n << " v=" << vIdx << " t=" << t << "\n";
+                        return false;
+                    }
+                }
+            }
+    return true;
+}
+
+// grayParents against the scalar rules, vertex by vertex, over whole blocks
+// and over a range cut inside each block: every v of [lo, hi) must be
+// visited exactly once, its swap position must give the parent and p must
+// be the parent's rank.
+bool grayAgrees(const RuleTable& rules, int n) {
+    const uint64_t N = FACT[n], B = grayBlockSize(n), rootIdx = rankPacked(PackedPerm::identity(n), n);
+    vector<uint8_t> seen(N);
+    for (int cut = 0; cut < 2 && (cut == 0 || B >= 4); ++cut)
+        for (int t = 1; t <= n-1; ++t) {
+            fill(seen.begin(), seen.end(), 0);
+            bool ok = true;
+            uint64_t bad = 0;
+            for (uint64_t block = 0; block < N; block += B) {
+                uint64_t lo = block + cut, hi = block + B - 2 * cut;
+                grayParents(rules, t, n, lo, hi, [&](uint64_t v, int j, uint64_t p) {
+                    if (v < lo || v >= hi || seen[v]++) { ok = false; bad = v; return; }
+                    if (v == rootIdx) return;
+                    PackedPerm w = unrankPacked(v, n), q = rules.parent(w, t, n);
+                    if (j < 0 || j >= n-1 || w.swapped(j) != q || p != rankPacked(q, n)) { ok = false; bad = v; }
+                });
+                for (uint64_t v = lo; v < hi && ok; ++v)
+                    if (!seen[v]) { ok = false; bad = v; }
+            }
+            if (!ok) {
+                cerr << "Gray-code walk disagrees with the rules: n=" << n << " v=" << bad << " t=" << t
+                     << (cut ? " (cut range)" : "") << "\n";
+                return false;
+            }
+        }
+    return true;
+}
+
+// The verifier on a forest it must reject. For n = 3 the graph is a 6-cycle;
+// T1 and T2 go round it in opposite directions, but T2 also sends the first
+// vertex after the root straight to it, so that vertex has the same one-edge
+// path in both trees and no internal vertex to share.
+bool verifierCatchesSharedEdge() {
+    const int n = 3;
+    PackedForest forest(n);
+    PackedTree t1 = forest.tree(1), t2 = forest.tree(2);
+    uint64_t cycle[6];                           // from the root, swapping 0, 1, 0, ...
+    PackedPerm p = PackedPerm::identity(n);
+    for (int k = 0; k < 6; ++k) { cycle[k] = rankPacked(p, n); p = p.swapped(k % 2); }
+    for (int k = 1; k < 6; ++k) {
+        t1.setSwapPos(cycle[k], (k - 1) % 2);    // back towards cycle[1]
+        t2.setSwapPos(cycle[k], k % 2);          // on towards cycle[5]
+    }
+    t2.setSwapPos(cycle[1], 0);
+    VerifyReport rep = verifyTrees(vector<PackedTree>{ t1, t2 }, n, 0, FACT[n]);
+    if (rep.dependent != 1 || rep.firstDependent != cycle[1]) {
+        cerr << "verifier missed a shared edge to the root: " << rep.dependent << " dependent\n";
+        return false;
+    }
+    return true;
+}
+
+template<class F>
+double bestOf(int reps, F&& f) {
+    double best = 1e30;
+    for (int r = 0; r < reps; ++r) {
+        auto t0 = chrono::steady_clock::now();
+        f();
+        auto t1 = chrono::steady_clock::now();
+        best = min(best, chrono::duration<double>(t1 - t0).count());
+    }
+    return best;
+}
+
+int main(int argc, char** argv) {
+    int maxN = (argc > 1 ? stoi(argv[1]) : 10);
+    int reps = (argc > 2 ? stoi(argv[2]) : 3);
+    if (maxN < 2 || maxN > MAX_IMPLICIT_N) {
+        cerr << "Usage: " << argv[0] << " [max n (2.." << MAX_IMPLICIT_N << ")] [reps]\n";
+        return 1;
+    }
+
+    if (!verifierCatchesSharedEdge()) return 1;
+    for (int n = 2; n <= min(maxN, 10); ++n) {
+        RuleTable rules(n);
+        if (!rulesAgree(rules, n) || !batchAgrees(rules, n) || !grayAgrees(rules, n)) return 1;
+    }
+
+    printf("batch kernel: %s\n", simdLevelName(activeSimdLevel()));
+    printf("%3s %10s %12s %12s %8s %12s %8s %12s %8s %12s %8s\n", "n", "edges",
+           "generic(s)", "fixed(s)", "speedup", "table(s)", "speedup", "batch(s)", "speedup",
+           "gray(s)", "vs batch");
+    for (int n = 2; n <= maxN; ++n) {
+        uint64_t N = FACT[n];
+        RuleTable rules(n);
+        uint64_t sumGeneric = 0, sumFixed = 0, sumTable = 0, sumBatch = 0, sumGray = 0;
+        double tg = bestOf(reps, [&] { sumGeneric = buildKernel(n, N); });
+        double tf = bestOf(reps, [&] { dispatchN(n, [&](auto nc) { sumFixed = buildKernel(nc, N); }); });
+        double tt = bestOf(reps, [&] { dispatchN(n, [&](auto nc) { sumTable = buildKernelTable(rules, nc, N); }); });
+        double tb = bestOf(reps, [&] { dispatchN(n, [&](auto nc) { sumBatch = buildKernelBatch(rules, nc, N); }); });
+        double tr = bestOf(reps, [&] { dispatchN(n, [&](auto nc) { sumGray = buildKernelGray(rules, nc, N); }); });
+        if (sumGeneric != sumFixed || sumGeneric != sumTable || sumGeneric != sumBatch || sumGeneric != sumGray) {
+            cerr << "kernel mismatch for n=" << n << "\n";
+            return 1;
+        }
+        printf("%3d %10llu %12.6f %12.6f %7.2fx %12.6f %7.2fx %12.6f %7.2fx %12.6f %7.2fx\n", n,
+               (unsigned long long)((n-1) * (N-1)), tg, tf, tg / tf, tt, tf / tt, tb, tt / tb, tr, tb / tr);
+    }
+    return 0;
+}
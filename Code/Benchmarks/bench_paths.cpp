@@ -0,0 +1,58 @@
+#include <bits/stdc++.h>
+#include <omp.h>
+#include "../Common/ist_query.h"
+#include "../Common/ist_paths.h"
+using namespace std;
+
+// Batch independent-path benchmark: for a fixed set of random sources per n,
+// extracts all n-1 paths to the root with independentPaths and reports
+// paths/second plus the average and maximum path length in each tree, and
+// how many sources do not reach the root in that tree.
+
+template<class F>
+double bestOf(int reps, F&& f) {
+    double best = 1e30;
+    for (int r = 0; r < reps; ++r) {
+        auto t0 = chrono::steady_clock::now();
+        f();
+        auto t1 = chrono::steady_clock::now();
+        best = min(best, chrono::duration<double>(t1 - t0).count());
+    }
+    return best;
+}
+
+int main(int argc, char** argv) {
+    int maxN = (argc > 1 ? stoi(argv[1]) : 12);
+    size_t nSources = (argc > 2 ? stoul(argv[2]) : 100000);
+    int reps = (argc > 3 ? stoi(argv[3]) : 3);
+    if (maxN < 6 || maxN > MAX_QUERY_N || nSources == 0) {
+        cerr << "Usage: " << argv[0] << " [max n (6.." << MAX_QUERY_N << ")] [sources] [reps]\n";
+        return 1;
+    }
+
+    printf("OpenMP threads: %d, sources per n: %zu\n", omp_get_max_threads(), nSources);
+    printf("%3s %12s %14s  %s\n", "n", "time(s)", "paths/s", "avg/max edges[/broken] per tree");
+    for (int n = 6; n <= maxN; ++n) {
+        IstQuery q(n);
+        mt19937_64 rng(n);
+        vector<uint64_t> sources(nSources);
+        for (uint64_t& v : sources) v = rng() % q.vertexCount();
+
+        PathBatch batch;
+        double tb = bestOf(reps, [&] { batch = independentPaths(q, sources); });
+
+        printf("%3d %12.6f %14.0f ", n, tb, (double)nSources * q.trees() / tb);
+        for (int t = 1; t <= q.trees(); ++t) {
+            uint64_t sum = 0, mx = 0, broken = 0;
+            for (size_t s = 0; s < nSources; ++s) {
+                sum += batch.edges(s, t);
+                mx = max(mx, batch.edges(s, t));
+                broken += !batch.reachesRoot(s, t);
+            }
+            printf(" %.1f/%llu", broken < nSources ? (double)sum / (nSources - broken) : 0.0, (unsigned long long)mx);
+            if (broken) printf("/%llu", (unsigned long long)broken);
+        }
+        printf("\n");
+    }
+    return 0;
+}
@@ -0,0 +1,143 @@
+#!/usr/bin/env python3
+"""Sweep the three programs over n, MPI ranks and OpenMP threads.
+
+Every run prints a "Phases:" line (Code/Common/phase_timer.h) with the
+wall-clock seconds of each phase; this driver repeats each configuration,
+takes per-phase medians and writes them as JSON and CSV, with speedup and
+efficiency against the serial program at the same n.
+
+Variants:
+  serial  serial_version.cpp                       (1 rank, 1 thread)
+  omp     parallel.cpp on one rank                 (threads from --threads)
+  hybrid  parallel.cpp on several ranks            (ranks > 1 from --ranks)
+  comm    parallel_communication.cpp               (every rank count)
+
+  python3 run_bench.py --build --n 9,10 --ranks 1,2,4 --threads 1,2 --repeats 5
+"""
+
+import argparse
+import csv
+import json
+import os
+import platform
+import re
+import shutil
+import statistics
+import subprocess
+import sys
+import tempfile
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+CODE = os.path.dirname(HERE)
+PHASES = ["load", "generate", "preprocess", "index", "build", "gather", "export", "verify", "total"]
+PHASE_LINE = re.compile(r"^Phases:(.*)$", re.M)
+
+
+def int_list(s):
+    return [int(x) for x in s.split(",") if x]
+
+
+def build(bin_dir):
+    os.makedirs(bin_dir, exist_ok=True)
+    cmds = [
+        ["g++", "-std=c++17", "-O2", os.path.join(CODE, "Serial Implementation", "serial_version.cpp"),
+         "-o", os.path.join(bin_dir, "serial_version")],
+        ["mpicxx", "-fopenmp", "-O2", os.path.join(CODE, "Parallel Implementation", "parallel.cpp"),
+         "-o", os.path.join(bin_dir, "parallel")],
+        ["mpicxx", "-fopenmp", "-O2", os.path.join(CODE, "Parallel Implementation", "parallel_communication.cpp"),
+         "-o", os.path.join(bin_dir, "parallel_communication")],
+    ]
+    for cmd in cmds:
+        print(" ".join(cmd), file=sys.stderr)
+        subprocess.run(cmd, check=True)
+
+
+def configs(args):
+    """(variant, program, ranks, threads) for every run of one n."""
+    out = []
+    if "serial" in args.variants:
+        out.append(("serial", "serial_version", 1, 1))
+    for t in args.threads:
+        if "omp" in args.variants:
+            out.append(("omp", "parallel", 1, t))
+        for r in args.ranks:
+            if "hybrid" in args.variants and r > 1:
+                out.append(("hybrid", "parallel", r, t))
+            if "comm" in args.variants:
+                out.append(("comm", "parallel_communication", r, t))
+    return out
+
+
+def run_once(args, program, n, ranks, threads, workdir):
+    exe = os.path.join(args.bin_dir, program)
+    cmd = [exe, str(n)] + args.program_args
+    if program != "serial_version":
+        cmd = args.mpirun.split() + ["-np", str(ranks)] + cmd
+    env = dict(os.environ, OMP_NUM_THREADS=str(threads))
+    res = subprocess.run(cmd, cwd=workdir, env=env, capture_output=True, text=True)
+    m = PHASE_LINE.search(res.stdout)
+    if res.returncode != 0 or not m:
+        raise RuntimeError("%s failed (exit %d):\n%s%s" % (" ".join(cmd), res.returncode, res.stdout, res.stderr))
+    fields = dict(kv.split("=") for kv in m.group(1).split())
+    return {p: float(fields.get(p, 0.0)) for p in PHASES}
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("--n", type=int_list, default=[8, 9, 10], help="comma-separated n values")
+    ap.add_argument("--ranks", type=int_list, default=[1, 2, 4])
+    ap.add_argument("--threads", type=int_list, default=[1, 2, 4])
+    ap.add_argument("--repeats", type=int, default=3)
+    ap.add_argument("--variants", default="serial,omp,hybrid,comm")
+    ap.add_argument("--bin-dir", default=os.path.join(HERE, "bin"), help="where the built programs are")
+    ap.add_argument("--build", action="store_true", help="compile the programs into --bin-dir first")
+    ap.add_argument("--mpirun", default="mpirun", help="launcher, e.g. 'mpirun --bind-to none'")
+    ap.add_argument("--args", dest="program_args", default="", help="extra program arguments, e.g. '--implicit'")
+    ap.add_argument("--out", default="bench_results", help="writes <out>.json and <out>.csv")
+    args = ap.parse_args()
+    args.variants = args.variants.split(",")
+    args.program_args = args.program_args.split()
+
+    if args.build:
+        build(args.bin_dir)
+
+    results = []
+    workdir = tempfile.mkdtemp(prefix="mist_bench_")   # output files land here
+    try:
+        for n in args.n:
+            for variant, program, ranks, threads in configs(args):
+                samples = [run_once(args, program, n, ranks, threads, workdir) for _ in range(args.repeats)]
+                median = {p: statistics.median(s[p] for s in samples) for p in PHASES}
+                results.append({"variant": variant, "n": n, "ranks": ranks, "threads": threads,
+                                "repeats": args.repeats, "median": median,
+                                "total": [s["total"] for s in samples]})
+                print("n=%-2d %-6s ranks=%-3d threads=%-3d total %.4f s (median of %d)"
+                      % (n, variant, ranks, threads, median["total"], args.repeats), file=sys.stderr)
+    finally:
+        shutil.rmtree(workdir, ignore_errors=True)
+
+    # speedup against the serial run of the same n; efficiency per core used
+    for r in results:
+        base = next((b for b in results if b["n"] == r["n"] and b["variant"] == "serial"), None)
+        if base and r["median"]["total"] > 0:
+            r["speedup"] = base["median"]["total"] / r["median"]["total"]
+            r["efficiency"] = r["speedup"] / (r["ranks"] * r["threads"])
+        else:
+            r["speedup"] = r["efficiency"] = None
+
+    with open(args.out + ".json", "w") as f:
+        json.dump({"host": platform.node(), "cpus": os.cpu_count(), "args": " ".join(args.program_args),
+                   "phases": PHASES, "results": results}, f, indent=2)
+    with open(args.out + ".csv", "w", newline="") as f:
+        w = csv.writer(f)
+        w.writerow(["variant", "n", "ranks", "threads", "repeats"] + PHASES + ["speedup", "efficiency"])
+        for r in results:
+            w.writerow([r["variant"], r["n"], r["ranks"], r["threads"], r["repeats"]]
+                       + ["%.6f" % r["median"][p] for p in PHASES]
+                       + ["" if r["speedup"] is None else "%.3f" % r["speedup"],
+                          "" if r["efficiency"] is None else "%.3f" % r["efficiency"]])
+    print("wrote %s.json and %s.csv" % (args.out, args.out), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
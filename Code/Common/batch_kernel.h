@@ -0,0 +1,183 @@
+#pragma once
+// Batched parent computation: for one tree t and PARENT_BATCH consecutive
+// vertices, compute the swap position and the parent's rank of every vertex.
+// Each stage is a loop over lanes with no per-lane branches (nibble compares
+// and selects instead of ctz/clz and table gathers), and the parent's rank is
+// the child's rank plus a Lehmer delta instead of a fresh rankPacked, so the
+// compiler vectorizes the lane loops. Only the RuleTable byte lookup is
+// scalar. The same source is built for AVX-512, AVX2 and the baseline ISA;
+// the widest one the CPU supports is picked at runtime. Unranking the child
+// (implicit mode) stays scalar.
+
+#include <cstdint>
+#include "packed_perm.h"
+#include "rule_table.h"
+#include "instrument.h"
+
+static const int PARENT_BATCH = 32;
+
+#if defined(__GNUC__) && defined(__x86_64__) && !defined(MIST_SCALAR_BATCH)
+#define MIST_BATCH_MULTIVERSION 1
+#endif
+
+// perms: packed children for vertices vBegin.., or nullptr to unrank them.
+// Lanes past `count` are left untouched.
+template<class Dim>
+__attribute__((always_inline)) inline
+void batchParentsBody(const RuleTable& rules, int t, Dim dim, uint64_t vBegin, int count,
+                      const PackedPerm* perms, uint8_t* __restrict swapPos,
+                      uint64_t* __restrict parentRank) {
+    const int n = dim;
+    const uint64_t id = PackedPerm::identity(n).w;
+    const uint8_t* table = rules.sym.data() + ((size_t)t << 9);
+    int64_t fRight[MAX_PACKED_N];                    // fRight[j] = (n-1-j)!
+    for (int j = 0; j < n; ++j) fRight[j] = (int64_t)FACT[n - 1 - j];
+    uint64_t w[PARENT_BATCH];
+    uint32_t key[PARENT_BATCH];
+    uint64_t fw1[PARENT_BATCH], sym[PARENT_BATCH];
+
+    if (perms) {
+        for (int l = 0; l < PARENT_BATCH; ++l) w[l] = perms[l < count ? l : 0].w;
+    } else {
+        for (int l = 0; l < PARENT_BATCH; ++l) w[l] = unrankPacked(vBegin + (l < count ? l : 0), dim).w;
+    }
+
+    // Rule key and firstWrong + 1 (highest nibble differing from the identity).
+    for (int l = 0; l < PARENT_BATCH; ++l) {
+        uint64_t d = w[l] ^ id;
+        uint32_t near = (uint32_t)(d == rules.nearMaskFirst) | (uint32_t)(d == rules.nearMaskLast);
+        uint32_t vn = (uint32_t)(w[l] >> (4*(n-1))) & 0xF;
+        uint32_t vn1 = (uint32_t)(w[l] >> (4*(n-2))) & 0xF;
+        key[l] = (vn << 5) | (vn1 << 1) | near;
+        uint32_t r = 1;
+        #pragma GCC unroll 16
+        for (int k = 2; k < n; ++k)
+            r = (((d >> (4*k)) & 0xF) != 0) ? (uint32_t)k : r;
+        fw1[l] = r + 1;
+    }
+#ifdef MIST_INSTRUMENT
+    countRuleKeys(t, key, count);
+#endif
+
+#ifdef MIST_REFERENCE_RULES
+    (void)table; (void)key;
+    for (int l = 0; l < PARENT_BATCH; ++l) sym[l] = referenceSymbol(PackedPerm{ w[l] }, t, dim);
+#else
+    // Byte gathers do not vectorize; 32 scalar loads from a 512-byte row are cheap.
+    for (int l = 0; l < PARENT_BATCH; ++l) sym[l] = table[key[l]];
+#endif
+
+    // The rest is split into short lane loops so each one vectorizes without
+    // spilling; every lane value is 64-bit to avoid width conversions.
+    int64_t pos[PARENT_BATCH], a[PARENT_BATCH], b[PARENT_BATCH];
+    int64_t ca[PARENT_BATCH], cb[PARENT_BATCH], fj[PARENT_BATCH], fj1[PARENT_BATCH];
+
+    // Swap position j and the nibbles a, b at j, j+1.
+    for (int l = 0; l < PARENT_BATCH; ++l) {
+        int64_t x = (int64_t)w[l];
+        int64_t s = (int64_t)(sym[l] != 0 ? sym[l] : fw1[l]) - 1;   // as a nibble value
+        int64_t j = 0;
+        #pragma GCC unroll 16
+        for (int k = 0; k < n; ++k)
+            j = (((x >> (4*k)) & 0xF) == s) ? k : j;
+        pos[l] = j;
+        a[l] = (x >> (4*j)) & 0xF;
+        b[l] = (x >> (4*j + 4)) & 0xF;
+    }
+
+    // c_a / c_b: symbols right of position j+1 smaller than a / b.
+    for (int l = 0; l < PARENT_BATCH; ++l) {
+        int64_t x = (int64_t)w[l], ra = 0, rb = 0;
+        #pragma GCC unroll 16
+        for (int k = 2; k < n; ++k) {
+            int64_t y = (x >> (4*k)) & 0xF;
+            int64_t right = -(int64_t)(k > pos[l] + 1);     // all ones right of j+1
+            ra += right & (int64_t)(y < a[l]);
+            rb += right & (int64_t)(y < b[l]);
+        }
+        ca[l] = ra;
+        cb[l] = rb;
+    }
+
+    // (n-1-j)! and (n-2-j)! picked with selects rather than a gather.
+    for (int l = 0; l < PARENT_BATCH; ++l) {
+        int64_t f0 = 0, f1 = 0;
+        #pragma GCC unroll 16
+        for (int k = 0; k < n; ++k) {
+            f0 = (k == pos[l]) ? fRight[k] : f0;
+            f1 = (k == pos[l] + 1) ? fRight[k] : f1;
+        }
+        fj[l] = f0;
+        fj1[l] = f1;
+    }
+
+    // Lehmer digits at j, j+1 change from (c_a + [b<a], c_b) to (c_b + [a<b], c_a).
+    for (int l = 0; l < PARENT_BATCH; ++l) {
+        int64_t order = (int64_t)(a[l] < b[l]) - (int64_t)(b[l] < a[l]);
+        int64_t delta = (cb[l] - ca[l]) * (fj[l] - fj1[l]) + order * fj[l];
+        swapPos[l] = (uint8_t)pos[l];
+        parentRank[l] = (uint64_t)((int64_t)(vBegin + l) + delta);
+    }
+}
+
+#ifdef MIST_BATCH_MULTIVERSION
+template<class Dim>
+__attribute__((target("avx512f,avx512vl,avx512bw,avx512dq")))
+void batchParentsAvx512(const RuleTable& rules, int t, Dim n, uint64_t vBegin, int count,
+                        const PackedPerm* perms, uint8_t* swapPos, uint64_t* parentRank) {
+    batchParentsBody(rules, t, n, vBegin, count, perms, swapPos, parentRank);
+}
+
+template<class Dim>
+__attribute__((target("avx2,bmi2")))
+void batchParentsAvx2(const RuleTable& rules, int t, Dim n, uint64_t vBegin, int count,
+                      const PackedPerm* perms, uint8_t* swapPos, uint64_t* parentRank) {
+    batchParentsBody(rules, t, n, vBegin, count, perms, swapPos, parentRank);
+}
+#endif
+
+template<class Dim>
+void batchParentsScalar(const RuleTable& rules, int t, Dim n, uint64_t vBegin, int count,
+                        const PackedPerm* perms, uint8_t* swapPos, uint64_t* parentRank) {
+    batchParentsBody(rules, t, n, vBegin, count, perms, swapPos, parentRank);
+}
+
+enum SimdLevel { SIMD_SCALAR = 0, SIMD_AVX2 = 1, SIMD_AVX512 = 2 };
+
+inline SimdLevel detectSimdLevel() {
+#ifdef MIST_BATCH_MULTIVERSION
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vl") &&
+        __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512dq"))
+        return SIMD_AVX512;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi2"))
+        return SIMD_AVX2;
+#endif
+    return SIMD_SCALAR;
+}
+
+inline const char* simdLevelName(SimdLevel level) {
+    return level == SIMD_AVX512 ? "avx512" : level == SIMD_AVX2 ? "avx2" : "scalar";
+}
+
+inline SimdLevel activeSimdLevel() {
+    static const SimdLevel level = detectSimdLevel();
+    return level;
+}
+
+// Parents of vertices [vBegin, vBegin+count) in tree t, count <= PARENT_BATCH.
+template<class Dim>
+inline void batchParents(const RuleTable& rules, int t, Dim n, uint64_t vBegin, int count,
+                         const PackedPerm* perms, uint8_t* swapPos, uint64_t* parentRank) {
+#ifdef MIST_INSTRUMENT
+    BusyScope busy(count);
+#endif
+#ifdef MIST_BATCH_MULTIVERSION
+    switch (activeSimdLevel()) {
+        case SIMD_AVX512: batchParentsAvx512(rules, t, n, vBegin, count, perms, swapPos, parentRank); return;
+        case SIMD_AVX2:   batchParentsAvx2(rules, t, n, vBegin, count, perms, swapPos, parentRank); return;
+        default: break;
+    }
+#endif
+    batchParentsScalar(rules, t, n, vBegin, count, perms, swapPos, parentRank);
+}
@@ -0,0 +1,62 @@
+#pragma once
+// 2D work decomposition over (tree, vertex range). The T*N (tree, vertex)
+// pairs are laid out tree-major, item = (t-1)*N + v, and each rank gets one
+// contiguous slice of that line, so any number of ranks gets an equal share
+// (to within SLICE_ALIGN items) instead of at most T ranks getting whole
+// trees. Cut points are rounded to SLICE_ALIGN items; N is even, so every
+// tile starts on an even vertex and maps to whole bytes of a PackedTree.
+//
+// A slice that crosses tree boundaries becomes several tiles, one per tree.
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include "perm_rank.h"
+#include "packed_perm.h"
+#include "packed_tree.h"
+
+struct Tile {
+    int t;                                       // tree, 1..T
+    uint64_t vBegin, vEnd;                       // vertex range [vBegin, vEnd)
+
+    uint64_t size() const { return vEnd - vBegin; }
+    size_t byteOffset() const { return (size_t)(vBegin >> 1); }   // in the tree's packed bytes
+    size_t byteSize() const { return (size_t)((vEnd - vBegin) >> 1); }
+};
+
+// Slices are cut at multiples of SLICE_ALIGN items (FOREST_PAD bytes), so a
+// slice is a whole number of fixed-size units of the packed forest.
+static const uint64_t SLICE_ALIGN = 2 * FOREST_PAD;
+
+// Aligned cut point of slice k out of parts over `total` items.
+inline uint64_t sliceCut(uint64_t total, int k, int parts) {
+    uint64_t c = (uint64_t)((unsigned __int128)total * (uint64_t)k / (uint64_t)parts);
+    return c / SLICE_ALIGN * SLICE_ALIGN;
+}
+
+// Tiles covering items [lo, hi) of the tree-major line, one per tree touched.
+inline std::vector<Tile> rangeTiles(int n, uint64_t lo, uint64_t hi) {
+    const uint64_t N = FACT[n];
+    std::vector<Tile> tiles;
+    while (lo < hi) {
+        int t = (int)(lo / N) + 1;
+        uint64_t treeEnd = (uint64_t)t * N;
+        uint64_t end = std::min(hi, treeEnd);
+        tiles.push_back(Tile{ t, lo - (treeEnd - N), end - (treeEnd - N) });
+        lo = end;
+    }
+    return tiles;
+}
+
+// Items [lo, hi) of slice k (of `parts`) for n-1 trees of n! vertices each.
+inline void sliceItems(int n, int k, int parts, uint64_t& lo, uint64_t& hi) {
+    const uint64_t total = (uint64_t)(n - 1) * FACT[n];
+    lo = sliceCut(total, k, parts);
+    hi = (k + 1 == parts) ? total : sliceCut(total, k + 1, parts);
+}
+
+inline std::vector<Tile> sliceTiles(int n, int k, int parts) {
+    uint64_t lo, hi;
+    sliceItems(n, k, parts, lo, hi);
+    return rangeTiles(n, lo, hi);
+}
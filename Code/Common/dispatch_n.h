@@ -0,0 +1,34 @@
+#pragma once
+// Runtime -> compile-time dispatch on n. A kernel written as a generic lambda
+// taking `auto n` is instantiated once per FixedN<2..16>, so the rule and
+// rank loops over n get fixed trip counts and the n-1/n-2 tests fold away.
+// Any other n (or MIST_GENERIC_KERNEL) falls back to a plain int.
+
+#include <type_traits>
+
+template<int N> using FixedN = std::integral_constant<int, N>;
+
+template<class F>
+inline void dispatchN(int n, F&& kernel) {
+#ifndef MIST_GENERIC_KERNEL
+    switch (n) {
+        case 2:  kernel(FixedN<2>{});  return;
+        case 3:  kernel(FixedN<3>{});  return;
+        case 4:  kernel(FixedN<4>{});  return;
+        case 5:  kernel(FixedN<5>{});  return;
+        case 6:  kernel(FixedN<6>{});  return;
+        case 7:  kernel(FixedN<7>{});  return;
+        case 8:  kernel(FixedN<8>{});  return;
+        case 9:  kernel(FixedN<9>{});  return;
+        case 10: kernel(FixedN<10>{}); return;
+        case 11: kernel(FixedN<11>{}); return;
+        case 12: kernel(FixedN<12>{}); return;
+        case 13: kernel(FixedN<13>{}); return;
+        case 14: kernel(FixedN<14>{}); return;
+        case 15: kernel(FixedN<15>{}); return;
+        case 16: kernel(FixedN<16>{}); return;
+        default: break;
+    }
+#endif
+    kernel(n);
+}
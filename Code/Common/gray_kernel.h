@@ -0,0 +1,134 @@
+#pragma once
+// Parent computation in adjacent-transposition (Gray-code) order.
+//
+// Vertices are cut into blocks of GRAY_SUFFIX! consecutive ranks: a block is
+// every arrangement of the last GRAY_SUFFIX symbols behind one fixed prefix.
+// Within a block the suffix is walked in Steinhaus-Johnson-Trotter order
+// (Knuth's Algorithm P, "plain changes"), so each vertex is its predecessor
+// with one adjacent swap. Alongside the permutation the walk keeps
+//   - its inverse (position of every symbol), so the rule symbol is found
+//     with one nibble read instead of a scan,
+//   - its Lehmer digits and rank: an adjacent swap changes just two digits,
+//     so the next vertex's rank and the parent's rank are O(1) deltas.
+// Nothing is unranked or re-ranked per vertex and no perms table is read.
+// A block spans GRAY_SUFFIX!/2 output bytes, so its scattered nibble writes
+// stay in L1, and blocks are natural work items for threads.
+
+#include <algorithm>
+#include <cstdint>
+#include "perm_rank.h"
+#include "packed_perm.h"
+#include "packed_tree.h"
+#include "rule_table.h"
+#include "instrument.h"
+
+static const int GRAY_SUFFIX = 6;                // block: 720 vertices sharing a prefix
+
+inline uint64_t grayBlockSize(int n) { return FACT[n < GRAY_SUFFIX ? n : GRAY_SUFFIX]; }
+
+// Calls f(v, swapPos, parentRank) for every vertex v of [lo, hi) in tree t,
+// in Gray-code order (not ascending). [lo, hi) must lie within one block.
+// The root's swap position and parent rank are meaningless.
+template<class Dim, class F>
+void grayParents(const RuleTable& rules, int t, Dim dim, uint64_t lo, uint64_t hi, F&& f) {
+    const int n = dim;
+    const int m = n < GRAY_SUFFIX ? n : GRAY_SUFFIX;
+    const int p0 = n - m;                        // first position of the suffix
+    const uint64_t id = PackedPerm::identity(n).w;
+    const uint8_t* table = rules.sym.data() + ((size_t)t << 9);
+    int64_t fRight[MAX_PACKED_N + 1] = {};       // fRight[j] = (n-1-j)!
+    for (int j = 0; j < n; ++j) fRight[j] = (int64_t)FACT[n - 1 - j];
+
+    // Start of the block: the prefix followed by the suffix in ascending order
+    uint64_t r = lo - lo % FACT[m];
+    PackedPerm w = unrankPacked(r, dim);
+    uint64_t inv = 0;                            // nibble s: position of symbol s+1
+    int lehmer[MAX_PACKED_N + 1] = {};
+    for (int i = 0; i < n; ++i) {
+        int a = (int)((w.w >> (4*i)) & 0xF);
+        inv |= (uint64_t)i << (4*a);
+        for (int k = i + 1; k < n; ++k) lehmer[i] += ((int)((w.w >> (4*k)) & 0xF) < a);
+    }
+    auto nib = [&](int j) { return (int)((w.w >> (4*j)) & 0xF); };
+    // rank change when positions j, j+1 (symbols a, b) are swapped
+    auto swapDelta = [&](int j, int a, int b) {
+        int dj = lehmer[j+1] + (a < b) - lehmer[j];
+        int dj1 = lehmer[j] - (b < a) - lehmer[j+1];
+        return dj * fRight[j] + dj1 * fRight[j+1];
+    };
+
+    uint64_t remaining = hi - lo;
+#ifdef MIST_INSTRUMENT
+    BusyScope busy((int)remaining);
+    uint64_t* keyHits = threadCounters().keyHits.data() + ((size_t)t << 9);
+#endif
+    int c[GRAY_SUFFIX + 1] = {}, o[GRAY_SUFFIX + 1];
+    std::fill(o, o + GRAY_SUFFIX + 1, 1);
+    while (true) {
+        if (r >= lo && r < hi) {
+            uint64_t d = w.w ^ id;
+            int near = (d == rules.nearMaskFirst) | (d == rules.nearMaskLast);
+            int key = (nib(n-1) << 5) | (nib(n-2) << 1) | near;
+#ifdef MIST_INSTRUMENT
+            keyHits[key]++;
+#endif
+#ifdef MIST_REFERENCE_RULES
+            (void)table; (void)key;
+            int s = referenceSymbol(w, t, dim);
+#else
+            int s = table[key];
+            if (s == 0) {
+                int fw = (63 - __builtin_clzll(d | 1)) >> 2;
+                s = (fw > 1 ? fw : 1) + 1;
+            }
+#endif
+            int j = (int)((inv >> (4*(s-1))) & 0xF);
+            f(r, j, (uint64_t)((int64_t)r + swapDelta(j, nib(j), nib(j+1))));
+            if (--remaining == 0) return;
+        }
+
+        // Algorithm P: find the next adjacent swap inside the suffix
+        int j = m, shift = 0, q;
+        while (true) {
+            q = c[j] + o[j];
+            if (q == j) {
+                if (j == 1) return;
+                shift++;
+            } else if (q >= 0) {
+                break;
+            }
+            o[j] = -o[j];
+            j--;
+        }
+        int x = p0 + std::min(j - c[j], j - q) + shift - 1;
+        c[j] = q;
+
+        int a = nib(x), b = nib(x+1);
+        r = (uint64_t)((int64_t)r + swapDelta(x, a, b));
+        int lx = lehmer[x];
+        lehmer[x] = lehmer[x+1] + (a < b);
+        lehmer[x+1] = lx - (b < a);
+        w = w.swapped(x);
+        inv ^= ((uint64_t)(x ^ (x+1)) << (4*a)) ^ ((uint64_t)(x ^ (x+1)) << (4*b));
+    }
+}
+
+// Swap positions of vertices [vBegin, vEnd) of tree t (vBegin even) into out,
+// whose first byte holds vBegin, block by block; rootIdx gets ROOT_SWAP.
+// Every nibble of the range is written; blocks are an even number of
+// vertices, so callers splitting a range at block boundaries never share a byte.
+template<class Dim>
+void grayFillRange(const RuleTable& rules, int t, Dim dim, uint64_t vBegin, uint64_t vEnd,
+                   uint8_t* out, uint64_t rootIdx) {
+    const uint64_t B = grayBlockSize(dim);
+    for (uint64_t lo = vBegin; lo < vEnd; ) {
+        uint64_t hi = std::min(vEnd, (lo / B + 1) * B);
+        grayParents(rules, t, dim, lo, hi, [&](uint64_t v, int j, uint64_t) {
+            uint8_t& byte = out[(v - vBegin) >> 1];
+            int sh = (int)((v - vBegin) & 1) * 4;
+            int val = (v == rootIdx) ? ROOT_SWAP : j;
+            byte = (uint8_t)((byte & ~(0xF << sh)) | (val << sh));
+        });
+        lo = hi;
+    }
+}
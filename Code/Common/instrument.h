@@ -0,0 +1,168 @@
+#pragma once
+// Optional hot-path counters, compiled in with -DMIST_INSTRUMENT:
+//   - how many vertices take each rule branch (RuleBranch), per tree,
+//   - vertices and busy seconds per thread inside batchParents,
+//   - seconds each thread waits on communication (CommWait scopes).
+// Each thread counts into its own ThreadCounters, so nothing is shared on
+// the hot path; reports add them up at the end of the run. Without the flag
+// the hooks compile to nothing and the report functions return at once.
+
+#include <algorithm>
+#include <cstdint>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+#include "rule_table.h"
+#include "phase_timer.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#ifdef MIST_INSTRUMENT
+static const bool MIST_INSTRUMENTED = true;
+#else
+static const bool MIST_INSTRUMENTED = false;
+#endif
+
+struct ThreadCounters {
+    int thread = 0;                              // OpenMP thread number at first use
+    uint64_t vertices = 0;
+    double busy = 0, commWait = 0;               // seconds
+    std::vector<uint64_t> keyHits = std::vector<uint64_t>((size_t)MAX_PACKED_N << 9, 0);   // RuleTable keys
+};
+
+struct InstrRegistry {
+    std::mutex lock;
+    std::vector<std::unique_ptr<ThreadCounters>> threads;
+};
+
+inline InstrRegistry& instrRegistry() {
+    static InstrRegistry registry;
+    return registry;
+}
+
+// The calling thread's counters, registered on first use.
+inline ThreadCounters& threadCounters() {
+    thread_local ThreadCounters* mine = nullptr;
+    if (!mine) {
+        InstrRegistry& reg = instrRegistry();
+        std::lock_guard<std::mutex> guard(reg.lock);
+        reg.threads.emplace_back(new ThreadCounters);
+        mine = reg.threads.back().get();
+#ifdef _OPENMP
+        mine->thread = omp_get_thread_num();
+#endif
+    }
+    return *mine;
+}
+
+#ifdef MIST_INSTRUMENT
+// Around one batchParents call.
+struct BusyScope {
+    ThreadCounters& c;
+    double start;
+    explicit BusyScope(int count) : c(threadCounters()), start(wallSeconds()) { c.vertices += count; }
+    ~BusyScope() { c.busy += wallSeconds() - start; }
+};
+
+// Around a blocking MPI call (or a lock taken only to call MPI).
+struct CommWait {
+    double start = wallSeconds();
+    ~CommWait() { threadCounters().commWait += wallSeconds() - start; }
+};
+
+inline void countRuleKeys(int t, const uint32_t* key, int count) {
+    uint64_t* hits = threadCounters().keyHits.data() + ((size_t)t << 9);
+    for (int l = 0; l < count; ++l) hits[key[l]]++;
+}
+#else
+struct CommWait { CommWait() {} };
+#endif
+
+// This process's hits as [t-1][branch], summed over threads.
+inline std::vector<uint64_t> ruleBranchHits(const RuleTable& rules) {
+    const int n = rules.n;
+    std::vector<uint64_t> hits((size_t)(n-1) * RULE_BRANCH_COUNT, 0);
+    InstrRegistry& reg = instrRegistry();
+    std::lock_guard<std::mutex> guard(reg.lock);
+    for (auto& c : reg.threads)
+        for (int t = 1; t <= n-1; ++t)
+            for (int vn = 1; vn <= n; ++vn)
+                for (int vn1 = 1; vn1 <= n; ++vn1)
+                    for (int near = 0; near < 2; ++near) {
+                        uint64_t h = c->keyHits[RuleTable::key(t, vn-1, vn1-1, near)];
+                        hits[(size_t)(t-1) * RULE_BRANCH_COUNT + rules.ruleBranch(t, vn, vn1, near != 0)] += h;
+                    }
+    return hits;
+}
+
+// {vertices, busy, commWait} per thread, ordered by thread number.
+inline std::vector<double> threadLoads() {
+    InstrRegistry& reg = instrRegistry();
+    std::lock_guard<std::mutex> guard(reg.lock);
+    std::vector<ThreadCounters*> sorted;
+    for (auto& c : reg.threads) sorted.push_back(c.get());
+    std::stable_sort(sorted.begin(), sorted.end(),
+                     [](const ThreadCounters* a, const ThreadCounters* b) { return a->thread < b->thread; });
+    std::vector<double> loads;
+    for (const ThreadCounters* c : sorted) {
+        loads.push_back((double)c->vertices);
+        loads.push_back(c->busy);
+        loads.push_back(c->commWait);
+    }
+    return loads;
+}
+
+inline void printRuleBranchHits(const std::vector<uint64_t>& hits, int T, std::ostream& os) {
+    os << "Rule branch hits (vertices per tree):\n" << std::setw(24) << std::left << "  branch" << std::right;
+    for (int t = 1; t <= T; ++t) os << std::setw(12) << ("T" + std::to_string(t));
+    os << "\n";
+    for (int b = 0; b < RULE_BRANCH_COUNT; ++b) {
+        bool any = false;
+        for (int t = 0; t < T; ++t) any |= hits[(size_t)t * RULE_BRANCH_COUNT + b] != 0;
+        if (!any) continue;
+        os << "  " << std::setw(22) << std::left << ruleBranchName(b) << std::right;
+        for (int t = 0; t < T; ++t) os << std::setw(12) << hits[(size_t)t * RULE_BRANCH_COUNT + b];
+        os << "\n";
+    }
+}
+
+// One line for a process (rank < 0: no MPI) from its threadLoads(); with
+// perThread, one more line per thread. Imbalance is max / mean over threads.
+inline void printThreadLoads(const double* loads, int threads, int rank, bool perThread, std::ostream& os) {
+    double vSum = 0, vMax = 0, vMin = 0, bSum = 0, bMax = 0, bMin = 0, wait = 0;
+    int working = 0;                             // threads that ran the kernel
+    for (int i = 0; i < threads; ++i) {
+        double v = loads[3*i], b = loads[3*i + 1];
+        wait += loads[3*i + 2];
+        if (v == 0) continue;
+        vMin = working ? std::min(vMin, v) : v;
+        bMin = working ? std::min(bMin, b) : b;
+        vMax = std::max(vMax, v);
+        bMax = std::max(bMax, b);
+        vSum += v;
+        bSum += b;
+        working++;
+    }
+    os << "  " << (rank < 0 ? std::string("process") : "rank " + std::to_string(rank)) << ": "
+       << working << " threads, vertices " << (uint64_t)vMin << ".." << (uint64_t)vMax;
+    if (working) os << " (imbalance " << vMax * working / vSum << ")";
+    os << ", busy " << bMin << ".." << bMax << " s";
+    if (working && bSum > 0) os << " (imbalance " << bMax * working / bSum << ")";
+    os << ", comm wait " << wait << " s\n";
+    if (perThread)
+        for (int i = 0; i < threads; ++i)
+            os << "    thread " << i << ": " << (uint64_t)loads[3*i] << " vertices, "
+               << loads[3*i + 1] << " s busy, " << loads[3*i + 2] << " s comm wait\n";
+}
+
+// Report for a single process; no-op unless built with MIST_INSTRUMENT.
+inline void printInstrumentReport(const RuleTable& rules, std::ostream& os) {
+    if (!MIST_INSTRUMENTED) return;
+    printRuleBranchHits(ruleBranchHits(rules), rules.n - 1, os);
+    std::vector<double> loads = threadLoads();
+    os << "Thread load:\n";
+    printThreadLoads(loads.data(), (int)loads.size() / 3, -1, true, os);
+}
@@ -0,0 +1,40 @@
+#pragma once
+// MIST_INSTRUMENT report across ranks: rule hits are summed on rank 0, and
+// every rank's thread loads are gathered there and printed one line per rank
+// (plus one per thread when there are few of them).
+
+#include <mpi.h>
+#include <ostream>
+#include <vector>
+#include "instrument.h"
+
+static const int INSTR_MAX_THREAD_LINES = 64;
+
+// Collective; no-op unless built with MIST_INSTRUMENT.
+inline void printInstrumentMPI(const RuleTable& rules, MPI_Comm comm, std::ostream& os) {
+    if (!MIST_INSTRUMENTED) return;
+    int rank, size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+
+    std::vector<uint64_t> hits = ruleBranchHits(rules), total(hits.size());
+    MPI_Reduce(hits.data(), total.data(), (int)hits.size(), MPI_UINT64_T, MPI_SUM, 0, comm);
+
+    std::vector<double> loads = threadLoads();
+    int count = (int)loads.size();
+    std::vector<int> counts(size), displs(size);
+    MPI_Gather(&count, 1, MPI_INT, counts.data(), 1, MPI_INT, 0, comm);
+    std::vector<double> all;
+    if (rank == 0) {
+        for (int r = 1; r < size; ++r) displs[r] = displs[r-1] + counts[r-1];
+        all.resize(displs[size-1] + counts[size-1]);
+    }
+    MPI_Gatherv(loads.data(), count, MPI_DOUBLE, all.data(), counts.data(), displs.data(), MPI_DOUBLE, 0, comm);
+
+    if (rank != 0) return;
+    printRuleBranchHits(total, rules.n - 1, os);
+    os << "Thread load:\n";
+    bool perThread = (int)all.size() / 3 <= INSTR_MAX_THREAD_LINES;
+    for (int r = 0; r < size; ++r)
+        printThreadLoads(all.data() + displs[r], counts[r] / 3, r, perThread, os);
+}
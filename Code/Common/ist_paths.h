@@ -0,0 +1,57 @@
+#pragma once
+// The n-1 paths from many sources to the root at once: path t of a source is
+// its path to the root in tree t, so where the trees are independent the n-1
+// paths are internally vertex-disjoint. Built on IstQuery, so nothing of size
+// n! is needed.
+//
+// All paths of a batch share one flat arena: path (s, t) is
+// vertex[offset[s*T + t-1] .. offset[s*T + t]), from source s to the root,
+// or empty if s does not reach the root in tree t (IstQuery::walkToRoot).
+// The arena is filled in two OpenMP passes over the sources, one measuring
+// path lengths and one writing the vertices after a prefix sum, so threads
+// never share or reallocate storage. Without OpenMP it runs serially.
+
+#include <cstdint>
+#include <vector>
+#include "ist_query.h"
+
+struct PathBatch {
+    int n = 0, T = 0;
+    std::vector<uint64_t> offset;                // sources*T + 1 entries
+    std::vector<uint64_t> vertex;                // all paths back to back
+
+    size_t sources() const { return T ? (offset.size() - 1) / T : 0; }
+    const uint64_t* begin(size_t s, int t) const { return vertex.data() + offset[s * T + t - 1]; }
+    const uint64_t* end(size_t s, int t) const { return vertex.data() + offset[s * T + t]; }
+    bool reachesRoot(size_t s, int t) const { return offset[s * T + t] != offset[s * T + t - 1]; }
+    uint64_t edges(size_t s, int t) const { return reachesRoot(s, t) ? offset[s * T + t] - offset[s * T + t - 1] - 1 : 0; }
+};
+
+inline PathBatch independentPaths(const IstQuery& q, const std::vector<uint64_t>& sources) {
+    PathBatch batch;
+    batch.n = q.n();
+    batch.T = q.trees();
+    const int T = batch.T;
+    const int64_t S = (int64_t)sources.size();
+    batch.offset.assign(S * T + 1, 0);
+
+    // path lengths, stored one slot to the right
+    #pragma omp parallel for schedule(dynamic, 64)
+    for (int64_t s = 0; s < S; ++s)
+        for (int t = 1; t <= T; ++t) {
+            uint64_t len = 0;
+            bool ok = q.walkToRoot(t, sources[s], [&](uint64_t) { ++len; });
+            batch.offset[s * T + t] = ok ? len : 0;
+        }
+    for (size_t i = 1; i < batch.offset.size(); ++i) batch.offset[i] += batch.offset[i - 1];
+
+    batch.vertex.resize(batch.offset.back());
+    #pragma omp parallel for schedule(dynamic, 64)
+    for (int64_t s = 0; s < S; ++s)
+        for (int t = 1; t <= T; ++t) {
+            if (!batch.reachesRoot((size_t)s, t)) continue;
+            uint64_t* out = batch.vertex.data() + batch.offset[s * T + t - 1];
+            q.walkToRoot(t, sources[s], [&](uint64_t u) { *out++ = u; });
+        }
+    return batch;
+}
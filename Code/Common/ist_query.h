@@ -0,0 +1,109 @@
+#pragma once
+// On-demand queries on the n-1 ISTs of B_n, with no tree, perms table or
+// index materialized: only the RuleTable (n*512 bytes) is built. Vertices are
+// 64-bit lexicographic ranks (the same indices the programs use) or packed
+// permutations, so any n up to MAX_QUERY_N works even where the full tree set
+// would never fit in memory. Each step is one rule lookup plus an O(n) rank
+// update (rankAfterSwap). The root is vertex 0, the identity, unless another
+// root r is given: the trees are then relabeled on the fly (relabel.h), so
+// every root costs the same and nothing is rebuilt.
+//
+//   IstQuery q(14);
+//   uint64_t p = q.parent(t, v);                   // v itself for the root
+//   std::vector<uint64_t> path = q.pathToRoot(t, v);   // v, ..., 0 (or empty)
+//   std::vector<uint64_t> ps = q.allParents(v);    // ps[t-1] = parent in tree t
+//   IstQuery qr(14, r);                            // the same trees rooted at r
+
+#include <cstdint>
+#include <vector>
+#include "perm_rank.h"
+#include "packed_perm.h"
+#include "rule_table.h"
+#include "relabel.h"
+
+static const int MAX_QUERY_N = MAX_PACKED_N;     // 16! ranks fit easily in 64 bits
+
+class IstQuery {
+public:
+    explicit IstQuery(int n) : IstQuery(n, PackedPerm::identity(n)) {}
+    IstQuery(int n, PackedPerm root)
+        : n_(n), rules_(n), root_(root), rootInv_(inversePerm(root, n)),
+          relabel_(!isIdentity(root, n)) {}
+
+    int n() const { return n_; }
+    int trees() const { return n_ - 1; }
+    uint64_t vertexCount() const { return FACT[n_]; }
+    uint64_t root() const { return rankPacked(root_, n_); }
+
+    PackedPerm perm(uint64_t v) const { return unrankPacked(v, n_); }
+    uint64_t rank(PackedPerm v) const { return rankPacked(v, n_); }
+
+    // Swap position j of v's edge to its parent in tree t (v.swapped(j) is
+    // the parent), or -1 for the root.
+    int parentSwap(int t, PackedPerm v) const {
+        return identitySwap(t, relabel_ ? composeSymbols(rootInv_, v, n_) : v);
+    }
+
+    PackedPerm parent(int t, PackedPerm v) const {
+        int j = parentSwap(t, v);
+        return j < 0 ? v : v.swapped(j);
+    }
+
+    uint64_t parent(int t, uint64_t v) const {
+        PackedPerm pv = perm(v);
+        int j = parentSwap(t, pv);
+        return j < 0 ? v : rankAfterSwap(pv, v, j, n_);
+    }
+
+    // Calls f(u) for every vertex u from v up to and including the root.
+    // Returns false if the parent chain of v runs into a cycle instead (the
+    // rules do not give a spanning tree for every t and n; see Brent's
+    // cycle detection below), after f has seen part of the cycle.
+    template<class F>
+    bool walkToRoot(int t, uint64_t v, F&& f) const {
+        PackedPerm pv = perm(v);
+        PackedPerm u = relabel_ ? composeSymbols(rootInv_, pv, n_) : pv;   // relabels along with pv
+        f(v);
+        uint64_t mark = v, power = 1, steps = 0;
+        for (int j; (j = identitySwap(t, u)) >= 0; ) {
+            v = rankAfterSwap(pv, v, j, n_);
+            pv = pv.swapped(j);
+            u = u.swapped(j);
+            f(v);
+            if (v == mark) return false;
+            if (++steps == power) { mark = v; power <<= 1; steps = 0; }
+        }
+        return true;
+    }
+
+    // v, ..., root; empty if v does not reach the root in tree t.
+    std::vector<uint64_t> pathToRoot(int t, uint64_t v) const {
+        std::vector<uint64_t> path;
+        if (!walkToRoot(t, v, [&](uint64_t u) { path.push_back(u); })) path.clear();
+        return path;
+    }
+
+    std::vector<uint64_t> allParents(uint64_t v) const {
+        PackedPerm pv = perm(v);
+        std::vector<uint64_t> ps(n_ - 1, v);
+        for (int t = 1; t <= n_ - 1; ++t) {
+            int j = parentSwap(t, pv);
+            if (j >= 0) ps[t - 1] = rankAfterSwap(pv, v, j, n_);
+        }
+        return ps;
+    }
+
+private:
+    // parentSwap for the trees rooted at the identity
+    int identitySwap(int t, PackedPerm u) const {
+        if (isIdentity(u, n_)) return -1;
+        PackedPerm p = rules_.parent(u, t, n_);
+        uint64_t d = u.w ^ p.w;
+        return d ? __builtin_ctzll(d) >> 2 : -1;
+    }
+
+    int n_;
+    RuleTable rules_;
+    PackedPerm root_, rootInv_;
+    bool relabel_;
+};
@@ -0,0 +1,43 @@
+#pragma once
+// Parent rules of the bubble-sort IST construction on packed permutations.
+// pos and firstWrong are derived from the packed word with bit operations,
+// so the same code serves the precomputed perms table and the implicit
+// mode (vertex unranked on the fly) without any per-edge heap allocation.
+
+#include <cstdint>
+#include "packed_perm.h"
+
+static const int MAX_TABLE_N = 10;           // perms table for all n! vertices
+static const int MAX_IMPLICIT_N = 12;        // vertex indices stay 32-bit
+
+template<class Dim>
+inline PackedPerm swapAdjacent(PackedPerm v, uint8_t symbol, Dim n) {
+    int j = v.positionOf(symbol);
+    if (j + 1 >= n) return v;
+    return v.swapped(j);
+}
+
+template<class Dim>
+inline PackedPerm findPosition(PackedPerm v, int t, Dim n) {
+    auto u = swapAdjacent(v, (uint8_t)t, n);
+    if (t == 2 && isIdentity(u, n)) return swapAdjacent(v, (uint8_t)(t-1), n);
+    uint8_t vn1 = v.at(n-2);
+    if (vn1 == t || vn1 == n-1) return swapAdjacent(v, (uint8_t)(firstWrongOf(v, n) + 1), n);
+    return u;
+}
+
+template<class Dim>
+inline PackedPerm parent1(PackedPerm v, int t, Dim n) {
+    uint8_t vn = v.at(n-1), vn1 = v.at(n-2);
+    if (vn == n) {
+        return (t != n-1 ? findPosition(v, t, n)
+                         : swapAdjacent(v, vn1, n));
+    }
+    if (vn == n-1 && vn1 == n) {
+        auto s = swapAdjacent(v, (uint8_t)n, n);
+        if (!isIdentity(s, n))
+            return (t == 1 ? s : swapAdjacent(v, (uint8_t)(t-1), n));
+    }
+    return (vn == t ? swapAdjacent(v, (uint8_t)n, n)
+                    : swapAdjacent(v, (uint8_t)t, n));
+}
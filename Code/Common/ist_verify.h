@@ -0,0 +1,171 @@
+#pragma once
+// Verification of built trees, run over a vertex range [lo, hi) so MPI ranks
+// can split the work (ist_verify_mpi.h); OpenMP threads split the range.
+//
+//   markReachable  - per tree, whether each vertex's parent chain ends at the
+//                    identity (vertex 0). A chain ends elsewhere if it enters
+//                    a cycle (Brent's detection), meets a second root or an
+//                    out-of-range swap position. Outcomes are memoized in a
+//                    shared status array, so each vertex is walked about once.
+//   countDependent - for every vertex whose n-1 chains all reach the root,
+//                    whether the n-1 root paths are internally vertex-disjoint.
+//                    The internal vertices of v's paths (at most the diameter,
+//                    n(n-1)/2, per path) are collected, sorted and checked for
+//                    a repeat, so a thread needs a few KB whatever N is.
+// Walks step with rankAfterSwap on the packed trees, so no parent arrays are
+// built. Without OpenMP the pragmas are ignored and everything runs serially.
+
+#include <algorithm>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+#include "perm_rank.h"
+#include "packed_perm.h"
+#include "packed_tree.h"
+
+enum : uint8_t { REACH_UNKNOWN = 0, REACH_ROOT = 1, REACH_NONE = 2 };
+
+struct VerifyReport {
+    std::vector<uint64_t> unreachable;           // per tree: vertices not reaching the root
+    uint64_t badEntries = 0;                     // misplaced roots / swap positions past n-2
+    uint64_t checked = 0;                        // vertices whose paths were compared
+    uint64_t dependent = 0;                      // vertices with two paths sharing a vertex
+    uint64_t firstDependent = UINT64_MAX;
+
+    bool ok() const {
+        for (uint64_t u : unreachable) if (u) return false;
+        return badEntries == 0 && dependent == 0;
+    }
+};
+
+// Entries of [lo, hi) that cannot belong to a tree rooted at vertex 0.
+inline uint64_t countBadEntries(PackedTree tree, uint64_t lo, uint64_t hi) {
+    const int n = tree.n;
+    uint64_t bad = 0;
+    #pragma omp parallel for schedule(static) reduction(+:bad)
+    for (int64_t v = (int64_t)lo; v < (int64_t)hi; ++v) {
+        int j = tree.swapPos((uint64_t)v);
+        bad += (v == 0) ? (j != ROOT_SWAP) : (j == ROOT_SWAP || j > n - 2);
+    }
+    return bad;
+}
+
+// Resolves status[v] for every v in [lo, hi) (and every vertex on the way);
+// returns how many of [lo, hi) do not reach the root.
+template<class Dim>
+uint64_t markReachable(PackedTree tree, Dim dim, uint64_t lo, uint64_t hi, uint8_t* status) {
+    const int n = dim;
+    auto load = [&](uint64_t u) { uint8_t s; _Pragma("omp atomic read") s = status[u]; return s; };
+    auto store = [&](uint64_t u, uint8_t s) { _Pragma("omp atomic write") status[u] = s; };
+    // parent of u, or u itself if its entry ends the chain
+    auto step = [&](uint64_t u, PackedPerm& pu) {
+        int j = tree.swapPos(u);
+        if (j == ROOT_SWAP || j > n - 2) return u;
+        uint64_t p = rankAfterSwap(pu, u, j, dim);
+        pu = pu.swapped(j);
+        return p;
+    };
+    uint64_t bad = 0;
+    #pragma omp parallel for schedule(dynamic, 4096) reduction(+:bad)
+    for (int64_t vi = (int64_t)lo; vi < (int64_t)hi; ++vi) {
+        uint64_t v = (uint64_t)vi;
+        uint8_t outcome = load(v);
+        if (outcome == REACH_UNKNOWN) {
+            // walk until a known vertex, the end of the chain, or a cycle
+            PackedPerm pu = unrankPacked(v, dim);
+            uint64_t u = v, mark = v, power = 1, steps = 0;
+            while (true) {
+                if ((outcome = load(u)) != REACH_UNKNOWN) break;
+                uint64_t p = step(u, pu);
+                if (p == u) { outcome = (u == 0 && tree.isRoot(0)) ? REACH_ROOT : REACH_NONE; break; }
+                u = p;
+                if (u == mark) { outcome = REACH_NONE; break; }
+                if (++steps == power) { mark = u; power <<= 1; steps = 0; }
+            }
+            // record it along the chain; stops on the first known vertex,
+            // which also ends the second lap of a cycle
+            pu = unrankPacked(v, dim);
+            for (u = v; load(u) == REACH_UNKNOWN; ) {
+                store(u, outcome);
+                uint64_t p = step(u, pu);
+                if (p == u) break;
+                u = p;
+            }
+        }
+        bad += (outcome != REACH_ROOT);
+    }
+    return bad;
+}
+
+// Vertices v in [lo, hi) reaching the root in every tree are checked; status
+// holds one array per tree, resolved (markReachable) at least on [lo, hi).
+template<class Dim>
+uint64_t countDependent(const std::vector<PackedTree>& trees, const std::vector<const uint8_t*>& status,
+                        Dim dim, uint64_t lo, uint64_t hi, uint64_t& checked, uint64_t& firstDependent) {
+    const int T = (int)trees.size();
+    uint64_t dependent = 0, nChecked = 0, first = UINT64_MAX;
+    #pragma omp parallel reduction(+:dependent, nChecked) reduction(min:first)
+    {
+        std::vector<uint64_t> onPaths;           // internal vertices of v's paths
+        #pragma omp for schedule(dynamic, 1024)
+        for (int64_t vi = (int64_t)lo; vi < (int64_t)hi; ++vi) {
+            uint64_t v = (uint64_t)vi;
+            if (v == 0) continue;
+            bool all = true;
+            for (int t = 0; t < T && all; ++t) all = (status[t][v] == REACH_ROOT);
+            if (!all) continue;
+            nChecked++;
+            PackedPerm pv = unrankPacked(v, dim);
+            onPaths.clear();
+            int direct = 0;                      // trees whose path is the edge v -> root
+            for (int t = 0; t < T; ++t) {
+                PackedPerm pu = pv;
+                uint64_t u = v;
+                for (bool firstStep = true; ; firstStep = false) {
+                    int j = trees[t].swapPos(u);
+                    u = rankAfterSwap(pu, u, j, dim);
+                    pu = pu.swapped(j);
+                    if (u == 0) { direct += firstStep; break; }
+                    onPaths.push_back(u);
+                }
+            }
+            // a path reaching the root has no repeats, so a repeat is shared;
+            // two direct edges have no internal vertex but are the same path
+            std::sort(onPaths.begin(), onPaths.end());
+            if (direct > 1 || std::adjacent_find(onPaths.begin(), onPaths.end()) != onPaths.end()) {
+                dependent++;
+                first = first < v ? first : v;
+            }
+        }
+    }
+    checked += nChecked;
+    if (first < firstDependent) firstDependent = first;
+    return dependent;
+}
+
+// Full check of all trees for vertices [lo, hi) on one process.
+template<class Dim>
+VerifyReport verifyTrees(const std::vector<PackedTree>& trees, Dim dim, uint64_t lo, uint64_t hi) {
+    const uint64_t N = trees[0].N;
+    VerifyReport rep;
+    std::vector<std::vector<uint8_t>> status(trees.size(), std::vector<uint8_t>(N, REACH_UNKNOWN));
+    std::vector<const uint8_t*> statusPtr;
+    for (size_t t = 0; t < trees.size(); ++t) {
+        rep.badEntries += countBadEntries(trees[t], lo, hi);
+        rep.unreachable.push_back(markReachable(trees[t], dim, lo, hi, status[t].data()));
+        statusPtr.push_back(status[t].data());
+    }
+    rep.dependent = countDependent(trees, statusPtr, dim, lo, hi, rep.checked, rep.firstDependent);
+    return rep;
+}
+
+inline void printVerifyReport(const VerifyReport& rep, std::ostream& os) {
+    for (size_t t = 0; t < rep.unreachable.size(); ++t)
+        if (rep.unreachable[t])
+            os << "  T" << t + 1 << ": " << rep.unreachable[t] << " vertices do not reach the root\n";
+    if (rep.badEntries) os << "  " << rep.badEntries << " invalid entries (misplaced root or swap position)\n";
+    os << "  independence: " << rep.checked << " vertices checked, " << rep.dependent
+       << " with paths sharing a vertex";
+    if (rep.dependent) os << " (first: " << rep.firstDependent << ")";
+    os << "\n  " << (rep.ok() ? "PASS" : "FAIL") << "\n";
+}
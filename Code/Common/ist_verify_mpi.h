@@ -0,0 +1,45 @@
+#pragma once
+// MPI driver for ist_verify.h. Every rank holds all trees and takes an equal
+// vertex range, resolving reachability and checking path independence for
+// that range only (walks may leave it, but only the range's outcomes are
+// read). Only the report's counters are reduced, onto every rank.
+
+#include <mpi.h>
+#include <cstdint>
+#include <vector>
+#include "dispatch_n.h"
+#include "ist_verify.h"
+
+inline VerifyReport verifyTreesMPI(const std::vector<PackedTree>& trees, int n, MPI_Comm comm) {
+    int rank, size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+    const uint64_t N = trees[0].N;
+    const int T = (int)trees.size();
+    uint64_t lo = N * (uint64_t)rank / (uint64_t)size, hi = N * (uint64_t)(rank + 1) / (uint64_t)size;
+
+    VerifyReport rep;
+    std::vector<std::vector<uint8_t>> status(T, std::vector<uint8_t>(N, REACH_UNKNOWN));
+    std::vector<const uint8_t*> statusPtr;
+    dispatchN(n, [&](auto nc) {
+        for (int t = 0; t < T; ++t) {
+            rep.badEntries += countBadEntries(trees[t], lo, hi);
+            rep.unreachable.push_back(markReachable(trees[t], nc, lo, hi, status[t].data()));
+            statusPtr.push_back(status[t].data());
+        }
+        rep.dependent = countDependent(trees, statusPtr, nc, lo, hi, rep.checked, rep.firstDependent);
+    });
+
+    // counters: unreachable per tree, bad entries, checked, dependent
+    std::vector<uint64_t> counts(rep.unreachable);
+    counts.push_back(rep.badEntries);
+    counts.push_back(rep.checked);
+    counts.push_back(rep.dependent);
+    MPI_Allreduce(MPI_IN_PLACE, counts.data(), (int)counts.size(), MPI_UINT64_T, MPI_SUM, comm);
+    MPI_Allreduce(MPI_IN_PLACE, &rep.firstDependent, 1, MPI_UINT64_T, MPI_MIN, comm);
+    for (int t = 0; t < T; ++t) rep.unreachable[t] = counts[t];
+    rep.badEntries = counts[T];
+    rep.checked = counts[T + 1];
+    rep.dependent = counts[T + 2];
+    return rep;
+}
@@ -0,0 +1,24 @@
+#pragma once
+// On-disk result cache: <root>/v<MIST_FORMAT_VERSION>/n<n>/Tn_<t>.mist.
+// A program given a cache root first tries to map all n-1 trees from there
+// (mist_mmap.h) and only computes them when that fails, writing its output
+// into the same directory. Bumping the format version starts a fresh cache.
+
+#include <sys/stat.h>
+#include <cerrno>
+#include <string>
+#include "mist_format.h"
+
+inline std::string mistCacheDir(const std::string& root, int n) {
+    return root + "/v" + std::to_string(MIST_FORMAT_VERSION) + "/n" + std::to_string(n);
+}
+
+// mkdir -p; true if the directory exists afterwards.
+inline bool makeMistCacheDir(const std::string& dir) {
+    for (size_t i = 1; i <= dir.size(); ++i) {
+        if (i < dir.size() && dir[i] != '/') continue;
+        if (mkdir(dir.substr(0, i).c_str(), 0755) != 0 && errno != EEXIST) return false;
+    }
+    struct stat st;
+    return stat(dir.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
@@ -0,0 +1,122 @@
+#pragma once
+// Restart point of a --stream run (mist_stream.h): Tn.checkpoint, next to
+// the Tn_<t>.mist files it describes.
+//
+//   offset  size  field
+//        0     4  magic "MCKP"
+//        4     4  format version of the .mist files (MIST_FORMAT_VERSION)
+//        8     4  n
+//       12     4  reserved, 0
+//       16     8  vertices per block
+//       24     8  block count
+//       32     -  (blocks+7)/8 bytes: bit b set once block b of every tree
+//                 has been written and synced to the .mist files
+//
+// Blocks are fixed vertex ranges, not per-rank slices, so a run may resume
+// with any number of ranks. A bit is set only after the files are synced,
+// and the checkpoint is replaced with write-then-rename, so a run killed at
+// any point leaves a checkpoint that under-reports, never over-reports.
+
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "mist_format.h"
+
+static const double CHECKPOINT_SECONDS = 60;     // default time between checkpoints
+
+struct CheckpointHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t n;
+    uint32_t reserved;
+    uint64_t blockSize;
+    uint64_t blocks;
+};
+static_assert(sizeof(CheckpointHeader) == 32, "CheckpointHeader must be 32 bytes");
+
+inline std::string checkpointPath(const std::string& dir) {
+    return dir.empty() ? "Tn.checkpoint" : dir + "/Tn.checkpoint";
+}
+
+// True if all n-1 files a checkpoint refers to are there at full size.
+inline bool streamFilesPresent(const std::string& dir, int n) {
+    for (int t = 1; t <= n - 1; ++t) {
+        struct stat st;
+        if (stat(mistFilePath(dir, t).c_str(), &st) != 0 ||
+            (uint64_t)st.st_size != MIST_HEADER_BYTES + (FACT[n] + 1) / 2) return false;
+    }
+    return true;
+}
+
+struct StreamCheckpoint {
+    int n = 0;
+    uint64_t blockSize = 0, blocks = 0;
+    std::vector<uint8_t> done;                   // one bit per block
+
+    StreamCheckpoint() = default;
+    StreamCheckpoint(int n_, uint64_t blockSize_, uint64_t blocks_)
+        : n(n_), blockSize(blockSize_), blocks(blocks_), done((blocks_ + 7) / 8, 0) {}
+
+    bool isDone(uint64_t b) const { return (done[b >> 3] >> (b & 7)) & 1; }
+    void markDone(uint64_t b) { done[b >> 3] |= (uint8_t)(1 << (b & 7)); }
+
+    uint64_t doneCount() const {
+        uint64_t c = 0;
+        for (uint8_t byte : done) c += (uint64_t)__builtin_popcount(byte);
+        return c;
+    }
+
+    // Blocks still to build, ascending.
+    std::vector<uint64_t> pending() const {
+        std::vector<uint64_t> todo;
+        for (uint64_t b = 0; b < blocks; ++b)
+            if (!isDone(b)) todo.push_back(b);
+        return todo;
+    }
+
+    // Replaces the checkpoint in dir; false if it could not be made durable.
+    bool save(const std::string& dir) const {
+        std::string path = checkpointPath(dir), tmp = path + ".tmp";
+        FILE* f = fopen(tmp.c_str(), "wb");
+        if (!f) return false;
+        CheckpointHeader h;
+        memcpy(h.magic, "MCKP", 4);
+        h.version = MIST_FORMAT_VERSION;
+        h.n = (uint32_t)n;
+        h.reserved = 0;
+        h.blockSize = blockSize;
+        h.blocks = blocks;
+        bool ok = fwrite(&h, sizeof(h), 1, f) == 1 &&
+                  fwrite(done.data(), 1, done.size(), f) == done.size() &&
+                  fflush(f) == 0 && fsync(fileno(f)) == 0;
+        ok = fclose(f) == 0 && ok;
+        return ok && rename(tmp.c_str(), path.c_str()) == 0;
+    }
+
+    // Reads the checkpoint in dir, which must match this one's n, block size
+    // and block count and whose tree files must all be there; err is set on
+    // failure, and the bitmap is then left empty.
+    bool load(const std::string& dir, std::string& err) {
+        std::string path = checkpointPath(dir);
+        FILE* f = fopen(path.c_str(), "rb");
+        if (!f) { err = "no checkpoint at " + path; return false; }
+        CheckpointHeader h;
+        bool ok = fread(&h, sizeof(h), 1, f) == 1;
+        err = !ok ? "short header"
+            : memcmp(h.magic, "MCKP", 4) != 0 ? "not a checkpoint file"
+            : h.version != MIST_FORMAT_VERSION ? "written for format version " + std::to_string(h.version)
+            : h.n != (uint32_t)n ? "written for n = " + std::to_string(h.n)
+            : h.blockSize != blockSize || h.blocks != blocks ? "written with a different block size"
+            : "";
+        if (err.empty() && fread(done.data(), 1, done.size(), f) != done.size()) err = "truncated bitmap";
+        fclose(f);
+        if (err.empty() && !streamFilesPresent(dir, n)) err = "tree files missing or resized";
+        if (!err.empty()) std::fill(done.begin(), done.end(), 0);
+        return err.empty();
+    }
+};
@@ -0,0 +1,98 @@
+#pragma once
+// Binary tree file, one per tree: Tn_<t>.mist
+//
+//   offset  size  field
+//        0     4  magic "MIST"
+//        4     4  format version (MIST_FORMAT_VERSION)
+//        8     4  n
+//       12     4  t, 1..n-1
+//       16     8  vertex count, n!
+//       24     4  encoding (MIST_ENC_SWAP4)
+//       28     4  reserved, 0
+//       32     -  (n!+1)/2 bytes: the tree's PackedTree bytes, i.e. a 4-bit
+//                 swap position per vertex, even vertex in the low nibble
+//
+// All integers are little-endian. The payload is byte-for-byte what
+// PackedTree uses in memory, so a reader can use it in place.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "perm_rank.h"
+#include "packed_tree.h"
+
+static const uint32_t MIST_FORMAT_VERSION = 1;
+static const uint32_t MIST_ENC_SWAP4 = 1;
+
+struct MistHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t n;
+    uint32_t t;
+    uint64_t vertexCount;
+    uint32_t encoding;
+    uint32_t reserved;
+};
+static_assert(sizeof(MistHeader) == 32, "MistHeader must be 32 bytes");
+
+static const size_t MIST_HEADER_BYTES = sizeof(MistHeader);
+
+inline MistHeader makeMistHeader(int n, int t) {
+    MistHeader h;
+    memcpy(h.magic, "MIST", 4);
+    h.version = MIST_FORMAT_VERSION;
+    h.n = (uint32_t)n;
+    h.t = (uint32_t)t;
+    h.vertexCount = FACT[n];
+    h.encoding = MIST_ENC_SWAP4;
+    h.reserved = 0;
+    return h;
+}
+
+inline uint64_t mistPayloadBytes(const MistHeader& h) { return (h.vertexCount + 1) / 2; }
+
+// Empty string if the header is usable, else what is wrong with it.
+inline std::string checkMistHeader(const MistHeader& h) {
+    if (memcmp(h.magic, "MIST", 4) != 0) return "not a .mist file";
+    if (h.version != MIST_FORMAT_VERSION) return "unsupported format version " + std::to_string(h.version);
+    if (h.encoding != MIST_ENC_SWAP4) return "unknown encoding " + std::to_string(h.encoding);
+    if (h.n < 2 || h.n > (uint32_t)MAX_PACKED_N) return "n out of range";
+    if (h.t < 1 || h.t >= h.n) return "t out of range";
+    if (h.vertexCount != FACT[h.n]) return "vertex count does not match n";
+    return "";
+}
+
+inline std::string mistFileName(int t) {
+    return "Tn_" + std::to_string(t) + ".mist";
+}
+
+// mistFileName(t) inside dir; an empty dir means the working directory.
+inline std::string mistFilePath(const std::string& dir, int t) {
+    return dir.empty() ? mistFileName(t) : dir + "/" + mistFileName(t);
+}
+
+// Single-writer path (serial program, or a rank that holds the whole tree).
+inline bool writeMistFile(const std::string& path, PackedTree tree, int t) {
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f) return false;
+    MistHeader h = makeMistHeader(tree.n, t);
+    bool ok = fwrite(&h, sizeof(h), 1, f) == 1 &&
+              fwrite(tree.bytes, 1, tree.byteSize(), f) == tree.byteSize();
+    return fclose(f) == 0 && ok;
+}
+
+// Reads a whole file into memory; err is set on failure.
+inline bool readMistFile(const std::string& path, MistHeader& h, std::vector<uint8_t>& payload, std::string& err) {
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) { err = "cannot open " + path; return false; }
+    bool ok = fread(&h, sizeof(h), 1, f) == 1;
+    err = ok ? checkMistHeader(h) : "short header";
+    if (err.empty()) {
+        payload.resize(mistPayloadBytes(h));
+        if (fread(payload.data(), 1, payload.size(), f) != payload.size()) err = "truncated payload";
+    }
+    fclose(f);
+    return err.empty();
+}
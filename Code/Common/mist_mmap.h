@@ -0,0 +1,88 @@
+#pragma once
+// Zero-copy loading of Tn_<t>.mist files (see mist_format.h). A file is
+// mmap'ed read-only and its payload is used directly as a PackedTree, so
+// opening a tree costs a header check and parent lookups page the bytes in
+// on demand. The view must not be written to (setSwapPos/storeBatch).
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+#include "packed_tree.h"
+#include "mist_format.h"
+
+class MappedTree {
+public:
+    MappedTree() = default;
+    MappedTree(const MappedTree&) = delete;
+    MappedTree& operator=(const MappedTree&) = delete;
+    MappedTree(MappedTree&& o) noexcept { *this = std::move(o); }
+    MappedTree& operator=(MappedTree&& o) noexcept {
+        std::swap(base_, o.base_);
+        std::swap(length_, o.length_);
+        std::swap(header_, o.header_);
+        return *this;
+    }
+    ~MappedTree() { if (base_) munmap(base_, length_); }
+
+    // Maps path; on failure returns false and sets err.
+    bool open(const std::string& path, std::string& err) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) { err = "cannot open " + path; return false; }
+        struct stat st;
+        size_t length = (fstat(fd, &st) == 0) ? (size_t)st.st_size : 0;
+        if (length < MIST_HEADER_BYTES) { ::close(fd); err = "short header"; return false; }
+        void* base = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (base == MAP_FAILED) { err = "cannot map " + path; return false; }
+        MappedTree m;
+        m.base_ = base;
+        m.length_ = length;
+        m.header_ = (const MistHeader*)base;
+        err = checkMistHeader(*m.header_);
+        if (err.empty() && length < MIST_HEADER_BYTES + mistPayloadBytes(*m.header_)) err = "truncated payload";
+        if (!err.empty()) return false;
+        *this = std::move(m);
+        return true;
+    }
+
+    bool isOpen() const { return base_ != nullptr; }
+    const MistHeader& header() const { return *header_; }
+
+    PackedTree tree() const {
+        uint8_t* payload = (uint8_t*)base_ + MIST_HEADER_BYTES;
+        return PackedTree{ (int)header_->n, header_->vertexCount, payload };
+    }
+
+private:
+    void* base_ = nullptr;
+    size_t length_ = 0;
+    const MistHeader* header_ = nullptr;
+};
+
+// All n-1 trees of one n, mapped from dir/Tn_<t>.mist.
+struct MappedForest {
+    int n = 0, T = 0;
+    std::vector<MappedTree> trees;               // trees[t-1]
+
+    // Fails (and sets err) unless every file exists and belongs to this n.
+    bool open(const std::string& dir, int n_, std::string& err) {
+        std::vector<MappedTree> mapped(n_ - 1);
+        for (int t = 1; t <= n_ - 1; ++t) {
+            std::string path = mistFilePath(dir, t);
+            if (!mapped[t - 1].open(path, err)) { err = path + ": " + err; return false; }
+            const MistHeader& h = mapped[t - 1].header();
+            if ((int)h.n != n_ || (int)h.t != t) { err = path + ": holds T" + std::to_string(h.n) + "_" + std::to_string(h.t); return false; }
+        }
+        n = n_;
+        T = n_ - 1;
+        trees = std::move(mapped);
+        return true;
+    }
+
+    PackedTree tree(int t) const { return trees[t - 1].tree(); }
+};
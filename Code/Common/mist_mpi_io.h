@@ -0,0 +1,130 @@
+#pragma once
+// Collective MPI-IO export of Tn_<t>.mist (see mist_format.h). Every rank
+// writes the tiles of its own slice at their offsets with
+// MPI_File_write_at_all, rank 0 adds the headers, and no rank ever holds a
+// whole tree. Files are opened collectively, one per tree.
+
+#include <mpi.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "decomposition.h"
+#include "mist_format.h"
+
+// True on every rank if ok is true on every rank (collective).
+inline bool allRanksOk(bool ok, MPI_Comm comm) {
+    int mine = ok, all = 0;
+    MPI_Allreduce(&mine, &all, 1, MPI_INT, MPI_LAND, comm);
+    return all != 0;
+}
+
+// tileBytes[k]: packed bytes of tiles[k] (this rank's tiles). Files go to
+// dir, or the working directory if it is empty. Collective; false on every
+// rank if any rank failed to open, size or write a file.
+inline bool writeMistCollective(int n, const std::vector<Tile>& tiles,
+                                const std::vector<uint8_t*>& tileBytes,
+                                const std::string& dir, MPI_Comm comm) {
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+    const uint64_t N = FACT[n];
+    bool ok = true;
+    for (int t = 1; t <= n - 1; ++t) {
+        MPI_File fh;
+        int opened = MPI_File_open(comm, mistFilePath(dir, t).c_str(), MPI_MODE_CREATE | MPI_MODE_WRONLY,
+                                   MPI_INFO_NULL, &fh) == MPI_SUCCESS;
+        if (!allRanksOk(opened, comm)) {
+            if (opened) MPI_File_close(&fh);
+            return false;
+        }
+        ok &= MPI_File_set_size(fh, (MPI_Offset)(MIST_HEADER_BYTES + (N + 1) / 2)) == MPI_SUCCESS;
+        // a rank has at most one tile per tree; ranks without one write nothing
+        MPI_Offset offset = 0;
+        const uint8_t* src = nullptr;
+        int count = 0;
+        for (size_t k = 0; k < tiles.size(); ++k) {
+            if (tiles[k].t != t) continue;
+            offset = (MPI_Offset)(MIST_HEADER_BYTES + tiles[k].byteOffset());
+            src = tileBytes[k];
+            count = (int)tiles[k].byteSize();
+        }
+        ok &= MPI_File_write_at_all(fh, offset, src, count, MPI_BYTE, MPI_STATUS_IGNORE) == MPI_SUCCESS;
+        // header last, so a run that dies mid-write leaves no valid file
+        if (rank == 0) {
+            MistHeader h = makeMistHeader(n, t);
+            ok &= MPI_File_write_at(fh, 0, &h, (int)sizeof(h), MPI_BYTE, MPI_STATUS_IGNORE) == MPI_SUCCESS;
+        }
+        ok &= MPI_File_close(&fh) == MPI_SUCCESS;
+    }
+    return allRanksOk(ok, comm);
+}
+
+// Streaming counterpart (mist_stream.h): all n-1 files stay open while
+// blocks are built, and each round every rank writes one block of every
+// tree with MPI_File_write_at_all (count 0 once it has run out of blocks).
+// Existing files are not truncated, so a resumed run keeps its finished
+// blocks. Rank 0 adds the headers on close.
+class MistStreamMPI {
+public:
+    // Collective; false on every rank if any file could not be opened or sized.
+    bool open(int n, const std::string& dir, MPI_Comm comm) {
+        n_ = n;
+        comm_ = comm;
+        int rank;
+        MPI_Comm_rank(comm, &rank);
+        bool ok = true;
+        for (int t = 1; t <= n - 1; ++t) {
+            MPI_File fh;
+            int opened = MPI_File_open(comm, mistFilePath(dir, t).c_str(), MPI_MODE_CREATE | MPI_MODE_WRONLY,
+                                       MPI_INFO_NULL, &fh) == MPI_SUCCESS;
+            if (!allRanksOk(opened, comm)) {
+                if (opened) MPI_File_close(&fh);
+                close(false);
+                return false;
+            }
+            files_.push_back(fh);
+            ok &= MPI_File_set_size(fh, (MPI_Offset)(MIST_HEADER_BYTES + (FACT[n] + 1) / 2)) == MPI_SUCCESS;
+            if (rank == 0) {                     // until close(true), the file fails checkMistHeader
+                MistHeader blank = {};
+                ok &= MPI_File_write_at(fh, 0, &blank, (int)sizeof(blank), MPI_BYTE, MPI_STATUS_IGNORE) == MPI_SUCCESS;
+            }
+        }
+        return allRanksOk(ok, comm);
+    }
+
+    // Collective per tree; byteOffset is within the tree's payload. False on
+    // every rank if any rank's write failed.
+    bool write(int t, uint64_t byteOffset, const uint8_t* bytes, size_t count) {
+        bool ok = MPI_File_write_at_all(files_[t-1], (MPI_Offset)(MIST_HEADER_BYTES + byteOffset), bytes,
+                                        (int)count, MPI_BYTE, MPI_STATUS_IGNORE) == MPI_SUCCESS;
+        return allRanksOk(ok, comm_);
+    }
+
+    // Collective; when it returns true, everything written so far is on disk.
+    bool sync() {
+        bool ok = true;
+        for (MPI_File& f : files_) ok &= MPI_File_sync(f) == MPI_SUCCESS;
+        return allRanksOk(ok, comm_);
+    }
+
+    // Collective. Headers are written only for a complete build, so files of
+    // a failed run stay invalid.
+    bool close(bool complete) {
+        int rank;
+        MPI_Comm_rank(comm_, &rank);
+        bool ok = true;
+        for (int t = 1; t <= (int)files_.size(); ++t) {
+            if (complete && rank == 0) {
+                MistHeader h = makeMistHeader(n_, t);
+                ok &= MPI_File_write_at(files_[t-1], 0, &h, (int)sizeof(h), MPI_BYTE, MPI_STATUS_IGNORE) == MPI_SUCCESS;
+            }
+            ok &= MPI_File_close(&files_[t-1]) == MPI_SUCCESS;
+        }
+        files_.clear();
+        return allRanksOk(ok, comm_);
+    }
+
+private:
+    int n_ = 0;
+    MPI_Comm comm_ = MPI_COMM_NULL;
+    std::vector<MPI_File> files_;
+};
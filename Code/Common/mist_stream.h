@@ -0,0 +1,125 @@
+#pragma once
+// Out-of-core construction: the vertex space is processed in blocks of
+// STREAM_BLOCK consecutive ranks, and each block's swap positions for all
+// n-1 trees are written to the Tn_<t>.mist files before the next block is
+// built. Memory is the T block buffers (n = 14: 13 x 5.9 MB) whatever n is,
+// so the output may be far larger than RAM. Ranks are 64-bit throughout;
+// vertices are unranked on the fly or walked in Gray-code order, never
+// tabled. Blocks are a whole number of Gray-code blocks and of batches.
+//
+// StreamBlockBuilder fills one block with OpenMP; MistStreamWriter is the
+// single-process writer (mist_mpi_io.h has the collective one).
+
+#include <unistd.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "perm_rank.h"
+#include "packed_tree.h"
+#include "rule_table.h"
+#include "batch_kernel.h"
+#include "gray_kernel.h"
+#include "mist_format.h"
+
+static const int MAX_STREAM_N = 14;              // 13 trees of 43.6 GB each
+static const uint64_t STREAM_BLOCK = 720 * 16384;    // vertices per block, 5.9 MB per tree
+
+inline uint64_t streamBlockCount(int n) { return (FACT[n] + STREAM_BLOCK - 1) / STREAM_BLOCK; }
+
+// Vertices [lo, hi) of block b.
+inline void streamBlockRange(int n, uint64_t b, uint64_t& lo, uint64_t& hi) {
+    lo = b * STREAM_BLOCK;
+    hi = std::min(FACT[n], lo + STREAM_BLOCK);
+}
+
+struct StreamBlockBuilder {
+    int n, T;
+    bool gray;
+    std::vector<std::vector<uint8_t>> out;       // per tree: the block's packed bytes
+
+    StreamBlockBuilder(int n_, bool gray_) : n(n_), T(n_ - 1), gray(gray_),
+        out(n_ - 1, std::vector<uint8_t>(STREAM_BLOCK / 2)) {}
+
+    // Builds vertices [lo, hi) of every tree into out; returns the bytes per tree.
+    template<class Dim>
+    size_t build(const RuleTable& rules, Dim dim, uint64_t lo, uint64_t hi, uint64_t rootIdx) {
+        const uint64_t step = gray ? grayBlockSize(dim) : (uint64_t)PARENT_BATCH;
+        const int64_t perTree = (int64_t)((hi - lo + step - 1) / step);
+        #pragma omp parallel
+        {
+            uint8_t swapPos[PARENT_BATCH];
+            uint64_t parentRank[PARENT_BATCH];
+            #pragma omp for schedule(static)
+            for (int64_t i = 0; i < perTree * T; ++i) {
+                int t = (int)(i / perTree) + 1;
+                uint64_t vBase = lo + (uint64_t)(i % perTree) * step;
+                uint64_t vEnd = std::min(hi, vBase + step);
+                uint8_t* dst = out[t-1].data() + ((vBase - lo) >> 1);
+                if (gray) {
+                    grayFillRange(rules, t, dim, vBase, vEnd, dst, rootIdx);
+                } else {
+                    int count = (int)(vEnd - vBase);
+                    batchParents(rules, t, dim, vBase, count, nullptr, swapPos, parentRank);
+                    packSwapBatch(dst, vBase, count, swapPos, rootIdx);
+                }
+            }
+        }
+        return (size_t)((hi - lo + 1) / 2);
+    }
+};
+
+// Writes the n-1 files, each sized up front so blocks can land in any order.
+// A zeroed header goes first and the real one last, so an interrupted run
+// leaves files that fail checkMistHeader. With keep, existing files are
+// opened without truncation, so the blocks a checkpoint records survive.
+class MistStreamWriter {
+public:
+    bool open(int n, const std::string& dir, bool keep = false) {
+        n_ = n;
+        MistHeader blank = {};
+        for (int t = 1; t <= n - 1; ++t) {
+            std::string path = mistFilePath(dir, t);
+            FILE* f = fopen(path.c_str(), keep ? "r+b" : "wb");
+            if (!f) return false;
+            files_.push_back(f);
+            if (ftruncate(fileno(f), (off_t)(MIST_HEADER_BYTES + (FACT[n] + 1) / 2)) != 0) return false;
+            if (fwrite(&blank, sizeof(blank), 1, f) != 1) return false;
+        }
+        return true;
+    }
+
+    // byteOffset is within the tree's payload.
+    bool write(int t, uint64_t byteOffset, const uint8_t* bytes, size_t count) {
+        FILE* f = files_[t-1];
+        return fseeko(f, (off_t)(MIST_HEADER_BYTES + byteOffset), SEEK_SET) == 0 &&
+               fwrite(bytes, 1, count, f) == count;
+    }
+
+    // Everything written so far is on disk once this returns true.
+    bool sync() {
+        bool ok = true;
+        for (FILE* f : files_) ok &= fflush(f) == 0 && fsync(fileno(f)) == 0;
+        return ok;
+    }
+
+    // Headers (only for a complete build, so files of a failed run stay
+    // invalid), then close; false if any write failed.
+    bool finish(bool complete) {
+        bool ok = true;
+        for (int t = 1; t <= (int)files_.size(); ++t) {
+            MistHeader h = makeMistHeader(n_, t);
+            if (complete) ok &= fseek(files_[t-1], 0, SEEK_SET) == 0 && fwrite(&h, sizeof(h), 1, files_[t-1]) == 1;
+            ok &= fclose(files_[t-1]) == 0;
+        }
+        files_.clear();
+        return ok;
+    }
+
+    ~MistStreamWriter() { for (FILE* f : files_) fclose(f); }
+
+private:
+    int n_ = 0;
+    std::vector<FILE*> files_;
+};
@@ -0,0 +1,140 @@
+#pragma once
+// Permutation of [1..n], n <= 16, packed 4 bits per symbol into one uint64_t.
+// Nibble j holds (symbol at position j) - 1. Position lookup, adjacent swap,
+// identity test and first-wrong position are plain bit operations, so the
+// parent rules run without touching the heap.
+//
+// Functions that depend on n take it as a template type Dim: a plain int,
+// or FixedN<N> (see dispatch_n.h) so loops over n get fixed trip counts.
+
+#include <cstdint>
+#include <string>
+#include "perm_rank.h"
+
+static const int MAX_PACKED_N = 16;
+
+static const uint64_t NIBBLE_LO = 0x1111111111111111ULL;
+static const uint64_t NIBBLE_HI = 0x8888888888888888ULL;
+static const uint64_t IDENTITY_NIBBLES = 0xFEDCBA9876543210ULL;
+
+inline uint64_t nibbleMask(int n) {
+    return n >= 16 ? ~0ULL : (1ULL << (4*n)) - 1;
+}
+
+struct PackedPerm {
+    uint64_t w;
+
+    static PackedPerm identity(int n) { return PackedPerm{ IDENTITY_NIBBLES & nibbleMask(n) }; }
+
+    // symbol at 0-based position j
+    uint8_t at(int j) const { return (uint8_t)(((w >> (4*j)) & 0xF) + 1); }
+
+    // 0-based position of symbol. Unused high nibbles read as symbol 1, but
+    // the zero-nibble test only yields false positives above a real match,
+    // and the real match always lies in the low n nibbles.
+    int positionOf(uint8_t symbol) const {
+        uint64_t x = w ^ (NIBBLE_LO * (uint64_t)(symbol - 1));
+        uint64_t z = (x - NIBBLE_LO) & ~x & NIBBLE_HI;
+        return __builtin_ctzll(z) >> 2;
+    }
+
+    // swap positions j and j+1
+    PackedPerm swapped(int j) const {
+        uint64_t d = ((w >> (4*j)) ^ (w >> (4*j + 4))) & 0xF;
+        return PackedPerm{ w ^ (d << (4*j)) ^ (d << (4*j + 4)) };
+    }
+
+    bool operator==(PackedPerm o) const { return w == o.w; }
+    bool operator!=(PackedPerm o) const { return w != o.w; }
+};
+
+template<class Dim>
+inline bool isIdentity(PackedPerm v, Dim n) {
+    return v == PackedPerm::identity(n);
+}
+
+// Rightmost 0-based position r with v[r] != r+1, clamped to 1 as the rules expect.
+template<class Dim>
+inline uint8_t firstWrongOf(PackedPerm v, Dim n) {
+    uint64_t d = v.w ^ PackedPerm::identity(n).w;
+    if (d == 0) return 1;
+    int r = (63 - __builtin_clzll(d)) >> 2;
+    return (uint8_t)(r <= 0 ? 1 : r);
+}
+
+inline PackedPerm packPerm(const uint8_t* p, int n) {
+    uint64_t w = 0;
+    for (int j = 0; j < n; ++j)
+        w |= (uint64_t)(p[j] - 1) << (4*j);
+    return PackedPerm{ w };
+}
+
+inline void unpackPerm(PackedPerm v, int n, uint8_t* out) {
+    for (int j = 0; j < n; ++j) out[j] = v.at(j);
+}
+
+// Same ordering as rankPerm(): lexicographic rank of the packed permutation.
+template<class Dim>
+inline uint64_t rankPacked(PackedPerm v, Dim dim) {
+    const int n = dim;
+    uint32_t used = 0;
+    uint64_t r = 0;
+    uint64_t w = v.w;
+    #pragma GCC unroll 16
+    for (int i = 0; i < n; ++i, w >>= 4) {
+        uint32_t s = (uint32_t)(w & 0xF);    // symbol - 1
+        uint32_t smallerUsed = popcountSmall(used & ((1u << s) - 1));
+        r += (uint64_t)(s - smallerUsed) * FACT[n - 1 - i];
+        used |= 1u << s;
+    }
+    return r;
+}
+
+template<class Dim>
+inline PackedPerm unrankPacked(uint64_t r, Dim dim) {
+    const int n = dim;
+    uint32_t avail = (1u << n) - 1;          // bit s set while symbol s+1 is unused
+    uint64_t w = 0;
+    #pragma GCC unroll 16
+    for (int i = 0; i < n; ++i) {
+        uint64_t f = FACT[n - 1 - i];
+        uint32_t d = (uint32_t)(r / f);
+        r -= (uint64_t)d * f;
+        uint32_t m = avail;
+        for (uint32_t k = 0; k < d; ++k) m &= m - 1;
+        uint32_t s = (uint32_t)__builtin_ctz(m);
+        w |= (uint64_t)s << (4*i);
+        avail &= ~(1u << s);
+    }
+    return PackedPerm{ w };
+}
+
+// Symbols of p as text: digits for n <= 9, comma-separated from n = 10 on
+// (or always, with alwaysCommas, to match vertex arguments).
+inline std::string permToString(PackedPerm p, int n, bool alwaysCommas = false) {
+    std::string s;
+    for (int j = 0; j < n; ++j) {
+        if ((alwaysCommas || n > 9) && j) s.push_back(',');
+        s += std::to_string(p.at(j));
+    }
+    return s;
+}
+
+// Rank of v.swapped(j) from r = rank of v: only the Lehmer digits at j and
+// j+1 change, from (c_a + [b<a], c_b) to (c_b + [a<b], c_a), where a, b are
+// the swapped symbols and c_a, c_b count smaller symbols right of j+1.
+template<class Dim>
+inline uint64_t rankAfterSwap(PackedPerm v, uint64_t r, int j, Dim dim) {
+    const int n = dim;
+    uint32_t a = (uint32_t)(v.w >> (4*j)) & 0xF;
+    uint32_t b = (uint32_t)(v.w >> (4*j + 4)) & 0xF;
+    int64_t ca = 0, cb = 0;
+    for (int k = j + 2; k < n; ++k) {
+        uint32_t y = (uint32_t)(v.w >> (4*k)) & 0xF;
+        ca += (y < a);
+        cb += (y < b);
+    }
+    int64_t fj = (int64_t)FACT[n - 1 - j], fj1 = (int64_t)FACT[n - 2 - j];
+    int64_t order = (int64_t)(a < b) - (int64_t)(b < a);
+    return (uint64_t)((int64_t)r + (cb - ca) * (fj - fj1) + order * fj);
+}
@@ -0,0 +1,94 @@
+#pragma once
+// One spanning tree stored as a 4-bit swap position per vertex: the parent of
+// v is v with positions j, j+1 swapped, so j (0..n-2) is all that is kept.
+// Two vertices share a byte (even vertex in the low nibble), giving n!/2
+// bytes per tree. The bytes are also what goes over the wire.
+//
+// Parents and children are recovered from ranks on demand (rankAfterSwap),
+// so nothing is decompressed: the children of p are the neighbours c =
+// p.swapped(j) whose stored swap position is j.
+
+#include <cstdint>
+#include <vector>
+#include "perm_rank.h"
+#include "packed_perm.h"
+
+static const uint8_t ROOT_SWAP = 0xF;            // marks the root (no parent)
+
+// Packs the swap positions of vertices vBase..vBase+count-1 (vBase even) into
+// out, whose first byte holds vBase. Whole bytes are written, so threads
+// filling disjoint batches never share a byte. rootIdx gets ROOT_SWAP.
+inline void packSwapBatch(uint8_t* out, uint64_t vBase, int count, const uint8_t* swapPos, uint64_t rootIdx) {
+    for (int l = 0; l < count; l += 2) {
+        uint8_t lo = (vBase + l == rootIdx) ? ROOT_SWAP : swapPos[l];
+        uint8_t hi = ROOT_SWAP;
+        if (l + 1 < count) hi = (vBase + l + 1 == rootIdx) ? ROOT_SWAP : swapPos[l + 1];
+        out[l >> 1] = (uint8_t)(lo | (hi << 4));
+    }
+}
+
+// View of one tree's packed bytes; the storage belongs to a PackedForest.
+struct PackedTree {
+    int n = 0;
+    uint64_t N = 0;                              // vertices, n!
+    uint8_t* bytes = nullptr;
+
+    size_t byteSize() const { return (size_t)((N + 1) / 2); }
+
+    int swapPos(uint64_t v) const {
+        return (bytes[v >> 1] >> ((v & 1) * 4)) & 0xF;
+    }
+
+    void setSwapPos(uint64_t v, int j) {
+        uint8_t& b = bytes[v >> 1];
+        int sh = (int)(v & 1) * 4;
+        b = (uint8_t)((b & ~(0xF << sh)) | ((j & 0xF) << sh));
+    }
+
+    // Stores the swap positions of vertices vBase..vBase+count-1 (vBase even).
+    void storeBatch(uint64_t vBase, int count, const uint8_t* swapPos, uint64_t rootIdx) {
+        packSwapBatch(bytes + (vBase >> 1), vBase, count, swapPos, rootIdx);
+    }
+
+    bool isRoot(uint64_t v) const { return swapPos(v) == ROOT_SWAP; }
+
+    // Parent index of v; the root is returned unchanged.
+    template<class Dim>
+    uint64_t parent(uint64_t v, Dim dim) const {
+        int j = swapPos(v);
+        if (j == ROOT_SWAP) return v;
+        return rankAfterSwap(unrankPacked(v, dim), v, j, dim);
+    }
+
+    // Calls f(c) for every child c of p, in swap-position order.
+    template<class Dim, class F>
+    void forEachChild(uint64_t p, Dim dim, F&& f) const {
+        const int n = dim;
+        PackedPerm pp = unrankPacked(p, dim);
+        for (int j = 0; j + 1 < n; ++j) {
+            uint64_t c = rankAfterSwap(pp, p, j, dim);
+            if (swapPos(c) == j) f(c);
+        }
+    }
+};
+
+// All n-1 trees back to back in one buffer, in the tree-major (tree, vertex)
+// order of decomposition.h: item (t-1)*N + v is the nibble of vertex v in
+// tree t, so any contiguous run of items is a contiguous run of bytes. The
+// buffer is padded to FOREST_PAD bytes so it can be moved in fixed-size units.
+static const size_t FOREST_PAD = 32;
+
+struct PackedForest {
+    int n = 0, T = 0;
+    uint64_t N = 0;
+    std::vector<uint8_t> bytes;
+
+    PackedForest() = default;
+    explicit PackedForest(int n_) : n(n_), T(n_ - 1), N(FACT[n_]),
+        bytes(((size_t)((uint64_t)(n_ - 1) * FACT[n_] / 2) + FOREST_PAD - 1) / FOREST_PAD * FOREST_PAD, 0xFF) {}
+
+    PackedTree tree(int t) { return PackedTree{ n, N, bytes.data() + (size_t)((uint64_t)(t - 1) * N / 2) }; }
+
+    // First byte of item i of the tree-major line (i even).
+    uint8_t* itemBytes(uint64_t i) { return bytes.data() + (size_t)(i >> 1); }
+};
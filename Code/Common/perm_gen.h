@@ -0,0 +1,44 @@
+#pragma once
+// Vertex table generation by rank range. The range [vBegin, vEnd) is split
+// into one contiguous chunk per OpenMP thread; each thread unranks the first
+// vertex of its chunk and steps with next_permutation, so the result is in
+// rank order and no thread depends on another. A rank that only needs a
+// slice of the vertices generates only that slice; index it as
+// perms[v - vBegin]. Without OpenMP the whole range is one chunk.
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "perm_rank.h"
+#include "packed_perm.h"
+
+// Writes vertices [vBegin, vEnd) to out[0 .. vEnd-vBegin).
+inline void generatePermRangeInto(int n, uint64_t vBegin, uint64_t vEnd, PackedPerm* out) {
+    const uint64_t total = vEnd - vBegin;
+    #pragma omp parallel
+    {
+        uint64_t tid = 0, nt = 1;
+#ifdef _OPENMP
+        tid = (uint64_t)omp_get_thread_num();
+        nt = (uint64_t)omp_get_num_threads();
+#endif
+        uint64_t lo = total * tid / nt, hi = total * (tid + 1) / nt;
+        if (lo < hi) {
+            uint8_t p[MAX_PACKED_N];
+            unrankPerm(vBegin + lo, n, p);
+            for (uint64_t i = lo; i < hi; ++i) {
+                out[i] = packPerm(p, n);
+                std::next_permutation(p, p + n);
+            }
+        }
+    }
+}
+
+inline std::vector<PackedPerm> generatePermRange(int n, uint64_t vBegin, uint64_t vEnd) {
+    std::vector<PackedPerm> out(vEnd - vBegin);
+    generatePermRangeInto(n, vBegin, vEnd, out.data());
+    return out;
+}
@@ -0,0 +1,70 @@
+#pragma once
+// Lexicographic rank/unrank of permutations of [1..n] (Lehmer code, i.e. the
+// factorial number system). The rank of a permutation is its index in
+// next_permutation order, so vertex index <-> permutation is pure arithmetic
+// and no lookup table over all n! vertices is needed.
+
+#include <cstdint>
+#include <vector>
+
+static const int MAX_RANK_N = 20;            // 20! is the largest factorial that fits in 64 bits
+
+static const uint64_t FACT[MAX_RANK_N + 1] = {
+    1ULL, 1ULL, 2ULL, 6ULL, 24ULL, 120ULL, 720ULL, 5040ULL, 40320ULL,
+    362880ULL, 3628800ULL, 39916800ULL, 479001600ULL, 6227020800ULL,
+    87178291200ULL, 1307674368000ULL, 20922789888000ULL,
+    355687428096000ULL, 6402373705728000ULL, 121645100408832000ULL,
+    2432902008176640000ULL
+};
+
+// Without -mpopcnt __builtin_popcount is a library call; the masks here are
+// at most 21 bits, so a few SWAR steps are cheaper.
+inline uint32_t popcountSmall(uint32_t x) {
+#ifdef __POPCNT__
+    return (uint32_t)__builtin_popcount(x);
+#else
+    x = x - ((x >> 1) & 0x55555555u);
+    x = (x & 0x33333333u) + ((x >> 2) & 0x33333333u);
+    x = (x + (x >> 4)) & 0x0F0F0F0Fu;
+    return (x * 0x01010101u) >> 24;
+#endif
+}
+
+// rank = sum_i d_i * (n-1-i)!, where d_i counts the symbols smaller than p[i]
+// that have not been used by p[0..i-1]. O(n) with one popcount per symbol.
+inline uint64_t rankPerm(const uint8_t* p, int n) {
+    uint32_t used = 0;                       // bit s set once symbol s has been seen
+    uint64_t r = 0;
+    for (int i = 0; i < n; ++i) {
+        uint32_t s = p[i];
+        uint32_t smallerUsed = popcountSmall(used & ((1u << s) - 1));
+        r += (uint64_t)(s - 1 - smallerUsed) * FACT[n - 1 - i];
+        used |= 1u << s;
+    }
+    return r;
+}
+
+inline uint64_t rankPerm(const std::vector<uint8_t>& p) {
+    return rankPerm(p.data(), (int)p.size());
+}
+
+// Inverse of rankPerm: writes the permutation with lexicographic rank r to out[0..n-1].
+inline void unrankPerm(uint64_t r, int n, uint8_t* out) {
+    uint32_t avail = ((1u << n) - 1) << 1;   // bit s set while symbol s is unused
+    for (int i = 0; i < n; ++i) {
+        uint64_t f = FACT[n - 1 - i];
+        uint32_t d = (uint32_t)(r / f);
+        r -= (uint64_t)d * f;
+        uint32_t m = avail;
+        for (uint32_t k = 0; k < d; ++k) m &= m - 1;     // drop the d lowest free symbols
+        uint32_t s = (uint32_t)__builtin_ctz(m);
+        out[i] = (uint8_t)s;
+        avail &= ~(1u << s);
+    }
+}
+
+inline std::vector<uint8_t> unrankPerm(uint64_t r, int n) {
+    std::vector<uint8_t> p(n);
+    unrankPerm(r, n, p.data());
+    return p;
+}
@@ -0,0 +1,57 @@
+#pragma once
+// Wall-clock time per program phase. clock() sums CPU time over all threads,
+// so it overstates OpenMP runs; every program times its phases here instead.
+// The "Phases:" line is what Benchmarks/run_bench.py parses.
+
+#include <chrono>
+#include <ostream>
+
+enum Phase {
+    PHASE_LOAD,          // mapping cached trees
+    PHASE_GENERATE,      // vertex (perms) table
+    PHASE_PREPROCESS,    // rule table, decomposition, output buffers, windows
+    PHASE_INDEX,         // children index for DOT export
+    PHASE_BUILD,         // parent computation
+    PHASE_GATHER,        // moving results between ranks
+    PHASE_EXPORT,        // writing .mist / .dot files
+    PHASE_VERIFY,
+    PHASE_COUNT
+};
+
+inline const char* phaseName(int p) {
+    static const char* names[PHASE_COUNT] = {
+        "load", "generate", "preprocess", "index", "build", "gather", "export", "verify"};
+    return names[p];
+}
+
+inline double wallSeconds() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// One phase runs at a time: start() ends the running phase and opens the next.
+// Time spent between phases (stop() .. start()) is counted in total() only.
+struct PhaseTimer {
+    double seconds[PHASE_COUNT] = {};
+    double begin = wallSeconds();
+    double mark = 0;
+    int current = -1;
+
+    void start(Phase p) {
+        double now = wallSeconds();
+        if (current >= 0) seconds[current] += now - mark;
+        current = p;
+        mark = now;
+    }
+    void stop() {
+        if (current >= 0) seconds[current] += wallSeconds() - mark;
+        current = -1;
+    }
+    double total() const { return wallSeconds() - begin; }
+};
+
+// Phases: load=0 generate=0.0123 ... total=0.456   (seconds, all phases listed)
+inline void printPhases(const double* seconds, double total, std::ostream& os) {
+    os << "Phases:";
+    for (int p = 0; p < PHASE_COUNT; ++p) os << " " << phaseName(p) << "=" << seconds[p];
+    os << " total=" << total << "\n";
+}
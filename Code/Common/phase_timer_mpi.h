@@ -0,0 +1,19 @@
+#pragma once
+// Reports a PhaseTimer across ranks: every phase is the maximum over ranks,
+// as the slowest rank decides when a collective phase ends.
+
+#include <mpi.h>
+#include <ostream>
+#include "phase_timer.h"
+
+// Collective; stops the running phase and prints on rank 0.
+inline void printPhasesMPI(PhaseTimer& timer, MPI_Comm comm, std::ostream& os) {
+    timer.stop();
+    double local[PHASE_COUNT + 1], longest[PHASE_COUNT + 1];
+    for (int p = 0; p < PHASE_COUNT; ++p) local[p] = timer.seconds[p];
+    local[PHASE_COUNT] = timer.total();
+    MPI_Reduce(local, longest, PHASE_COUNT + 1, MPI_DOUBLE, MPI_MAX, 0, comm);
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+    if (rank == 0) printPhases(longest, longest[PHASE_COUNT], os);
+}
@@ -0,0 +1,71 @@
+#pragma once
+// Pieces for the pipelined result transfer (--pipeline):
+//
+//   PutRing        - a fixed ring of chunk buffers per thread. A chunk is
+//                    computed into the next slot and sent with MPI_Rput; the
+//                    slot is only reused after that put has completed
+//                    locally, so up to `depth` puts are in flight while the
+//                    thread keeps computing, and buffer memory is capped at
+//                    depth * slotBytes per thread.
+//   ProgressThread - polls a private communicator so the MPI progress engine
+//                    keeps moving RMA traffic while every OpenMP thread is
+//                    computing. Needs MPI_THREAD_MULTIPLE.
+
+#include <mpi.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+static const int PIPELINE_DEPTH = 4;
+
+struct PutRing {
+    std::vector<std::vector<uint8_t>> slots;
+    std::vector<MPI_Request> pending;
+    int head = 0;
+
+    PutRing(int depth, size_t slotBytes)
+        : slots(depth, std::vector<uint8_t>(slotBytes)), pending(depth, MPI_REQUEST_NULL) {}
+
+    // Next free buffer; waits for the put that last used it.
+    uint8_t* acquire() {
+        MPI_Wait(&pending[head], MPI_STATUS_IGNORE);
+        return slots[head].data();
+    }
+
+    // Sends the buffer returned by acquire() to byte offset disp on target.
+    void put(int bytes, int target, MPI_Aint disp, MPI_Win win) {
+        MPI_Rput(slots[head].data(), bytes, MPI_BYTE, target, disp, bytes, MPI_BYTE, win, &pending[head]);
+        head = (head + 1) % (int)slots.size();
+    }
+
+    void drain() {
+        MPI_Waitall((int)pending.size(), pending.data(), MPI_STATUSES_IGNORE);
+    }
+};
+
+class ProgressThread {
+public:
+    explicit ProgressThread(MPI_Comm comm) {
+        MPI_Comm_dup(comm, &pollComm);
+        worker = std::thread([this] {
+            while (!stop.load(std::memory_order_relaxed)) {
+                int flag;
+                MPI_Iprobe(MPI_ANY_SOURCE, MPI_ANY_TAG, pollComm, &flag, MPI_STATUS_IGNORE);
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+            }
+        });
+    }
+
+    ~ProgressThread() {
+        stop = true;
+        worker.join();
+        MPI_Comm_free(&pollComm);
+    }
+
+private:
+    MPI_Comm pollComm;
+    std::atomic<bool> stop{false};
+    std::thread worker;
+};
@@ -0,0 +1,33 @@
+#pragma once
+// Trees rooted at any vertex r, by relabeling symbols. Replacing every symbol
+// x of a permutation u by r(x) (the composition r∘u) is an automorphism of
+// B_n: it commutes with swapping positions j, j+1. So the trees rooted at
+// the identity map onto trees rooted at r, with
+//   parent_r(v) = r∘parent(r⁻¹∘v),
+// and the swap position of v's edge in a tree rooted at r is the stored swap
+// position of r⁻¹∘v. Nothing is rebuilt; each query costs one extra O(n)
+// relabel.
+
+#include <cstdint>
+#include "packed_perm.h"
+
+// g∘u: symbol x of u becomes g(x).
+template<class Dim>
+inline PackedPerm composeSymbols(PackedPerm g, PackedPerm u, Dim dim) {
+    const int n = dim;
+    uint64_t w = 0;
+    for (int j = 0; j < n; ++j) {
+        uint64_t s = (u.w >> (4*j)) & 0xF;
+        w |= ((g.w >> (4*s)) & 0xF) << (4*j);
+    }
+    return PackedPerm{ w };
+}
+
+template<class Dim>
+inline PackedPerm inversePerm(PackedPerm g, Dim dim) {
+    const int n = dim;
+    uint64_t w = 0;
+    for (int j = 0; j < n; ++j)
+        w |= (uint64_t)j << (4 * ((g.w >> (4*j)) & 0xF));
+    return PackedPerm{ w };
+}
@@ -0,0 +1,116 @@
+#pragma once
+// Table-driven form of the parent rules in ist_rules.h. For a fixed n every
+// branch of parent1/findPosition depends only on
+//   (t, last symbol vn, second-to-last symbol vn1, nearIdentity)
+// where nearIdentity means v is the identity with its first or last adjacent
+// pair swapped (the two "u == root" tests). The table maps that key to the
+// symbol whose right neighbour is swapped, or 0 for "firstWrong + 1", so a
+// parent is one lookup, one select and one nibble swap with no data-dependent
+// branches. parent1 stays as the reference path: built with
+// MIST_REFERENCE_RULES, RuleTable::parent and the batch and Gray-code
+// kernels all call it instead of reading the table.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "packed_perm.h"
+#include "ist_rules.h"
+
+// Branches of parent1/findPosition, as counted by MIST_INSTRUMENT builds.
+enum RuleBranch {
+    RULE_LAST_T_N1,          // vn = n, t = n-1: swap vn-1
+    RULE_LAST_T2_NEAR,       // vn = n, t = 2, swapping t gives the root: swap 1
+    RULE_LAST_FIRST_WRONG,   // vn = n, vn-1 in {t, n-1}: swap firstWrong + 1
+    RULE_LAST_T,             // vn = n otherwise: swap t
+    RULE_N_BEFORE_LAST,      // vn = n-1, vn-1 = n: swap n (t = 1) or t-1
+    RULE_VN_IS_T,            // vn = t: swap n
+    RULE_T,                  // otherwise: swap t
+    RULE_BRANCH_COUNT
+};
+
+inline const char* ruleBranchName(int b) {
+    static const char* names[RULE_BRANCH_COUNT] = {
+        "vn=n, t=n-1", "vn=n, t=2, near root", "vn=n, firstWrong", "vn=n, swap t",
+        "vn=n-1, vn-1=n", "vn=t, swap n", "swap t"};
+    return names[b];
+}
+
+struct RuleTable {
+    int n = 0;
+    uint64_t nearMaskFirst = 0, nearMaskLast = 0;    // v ^ identity for the two special vertices
+    std::vector<uint8_t> sym;                        // [t][vn-1][vn1-1][nearIdentity], 512 bytes per t
+
+    // Symbols enter as packed nibbles (symbol - 1), so the key is pure shifts.
+    static size_t key(int t, int vnNibble, int vn1Nibble, int near) {
+        return ((size_t)t << 9) | ((size_t)vnNibble << 5) | ((size_t)vn1Nibble << 1) | (size_t)near;
+    }
+
+    explicit RuleTable(int n_) : n(n_), sym((size_t)n_ << 9, 0) {
+        nearMaskFirst = 0x11ULL;                     // nibbles 0,1 hold 0^1 after the swap
+        nearMaskLast = (uint64_t)(((n-2) ^ (n-1)) & 0xF) * (0x11ULL << (4*(n-2)));
+        for (int t = 1; t <= n-1; ++t)
+            for (int vn = 1; vn <= n; ++vn)
+                for (int vn1 = 1; vn1 <= n; ++vn1)
+                    for (int near = 0; near < 2; ++near)
+                        sym[key(t, vn-1, vn1-1, near)] = ruleSymbol(t, vn, vn1, near != 0);
+    }
+
+    // Mirrors the branch structure of parent1/findPosition.
+    uint8_t ruleSymbol(int t, int vn, int vn1, bool near) const {
+        if (vn == n) {
+            if (t == n-1) return (uint8_t)vn1;
+            if (t == 2 && near) return (uint8_t)(t-1);
+            if (vn1 == t || vn1 == n-1) return 0;    // firstWrong + 1
+            return (uint8_t)t;
+        }
+        if (vn == n-1 && vn1 == n && !near)
+            return (uint8_t)(t == 1 ? n : t-1);
+        return (uint8_t)(vn == t ? n : t);
+    }
+
+    // Which branch ruleSymbol takes for the same key.
+    RuleBranch ruleBranch(int t, int vn, int vn1, bool near) const {
+        if (vn == n) {
+            if (t == n-1) return RULE_LAST_T_N1;
+            if (t == 2 && near) return RULE_LAST_T2_NEAR;
+            if (vn1 == t || vn1 == n-1) return RULE_LAST_FIRST_WRONG;
+            return RULE_LAST_T;
+        }
+        if (vn == n-1 && vn1 == n && !near) return RULE_N_BEFORE_LAST;
+        return vn == t ? RULE_VN_IS_T : RULE_T;
+    }
+
+    template<class Dim>
+    PackedPerm parent(PackedPerm v, int t, Dim dim) const {
+#ifdef MIST_REFERENCE_RULES
+        return parent1(v, t, dim);
+#else
+        return tableParent(v, t, dim);
+#endif
+    }
+
+    // The table path whatever the build flags, so it can be checked against parent1.
+    template<class Dim>
+    PackedPerm tableParent(PackedPerm v, int t, Dim dim) const {
+        const int n = dim;
+        uint64_t d = v.w ^ PackedPerm::identity(n).w;
+        int near = (d == nearMaskFirst) | (d == nearMaskLast);
+        int vnNibble = (int)((v.w >> (4*(n-1))) & 0xF);
+        int vn1Nibble = (int)((v.w >> (4*(n-2))) & 0xF);
+        uint8_t s = sym[key(t, vnNibble, vn1Nibble, near)];
+        // firstWrong + 1 without branches: highest differing nibble, at least 1
+        int r = (63 - __builtin_clzll(d | 1)) >> 2;
+        uint8_t fw1 = (uint8_t)((r > 1 ? r : 1) + 1);
+        s = (s != 0 ? s : fw1);
+        return v.swapped(v.positionOf(s));
+    }
+};
+
+// The symbol whose right neighbour parent1 swaps, i.e. what the table lookup
+// resolves to; the kernels use it under MIST_REFERENCE_RULES. (Symbol 1 if
+// parent1 leaves v unchanged, which only the root may.)
+template<class Dim>
+inline uint8_t referenceSymbol(PackedPerm v, int t, Dim dim) {
+    uint64_t d = v.w ^ parent1(v, t, dim).w;
+    return d ? v.at(__builtin_ctzll(d) >> 2) : 1;
+}
@@ -0,0 +1,55 @@
+#pragma once
+// Node-wide read-only vertex table. All ranks on a node (MPI_Comm_split_type
+// SHARED) map one MPI_Win_allocate_shared segment holding the packed
+// permutation of every vertex, so the table costs n!*8 bytes per node rather
+// than per rank. Local ranks fill equal parts of it side by side, then
+// synchronize once; afterwards it is only read.
+//
+// close() is collective over the node and must run before MPI_Finalize.
+
+#include <mpi.h>
+#include <cstdint>
+#include "perm_rank.h"
+#include "packed_perm.h"
+#include "perm_gen.h"
+
+struct NodeSharedPerms {
+    MPI_Comm nodeComm = MPI_COMM_NULL;
+    MPI_Win win = MPI_WIN_NULL;
+    const PackedPerm* perms = nullptr;           // vertex v at perms[v]
+    int nodeRank = 0, nodeSize = 1;
+
+    NodeSharedPerms() = default;
+
+    NodeSharedPerms(int n, MPI_Comm comm) {
+        const uint64_t N = FACT[n];
+        MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &nodeComm);
+        MPI_Comm_rank(nodeComm, &nodeRank);
+        MPI_Comm_size(nodeComm, &nodeSize);
+
+        // node rank 0 owns the segment, the others attach to it
+        PackedPerm* base;
+        MPI_Aint bytes = (nodeRank == 0) ? (MPI_Aint)(N * sizeof(PackedPerm)) : 0;
+        MPI_Win_allocate_shared(bytes, sizeof(PackedPerm), MPI_INFO_NULL, nodeComm, &base, &win);
+        MPI_Aint segBytes;
+        int dispUnit;
+        MPI_Win_shared_query(win, 0, &segBytes, &dispUnit, &base);
+
+        MPI_Win_lock_all(MPI_MODE_NOCHECK, win);
+        uint64_t lo = N * (uint64_t)nodeRank / (uint64_t)nodeSize;
+        uint64_t hi = N * (uint64_t)(nodeRank + 1) / (uint64_t)nodeSize;
+        generatePermRangeInto(n, lo, hi, base + lo);
+        MPI_Win_sync(win);
+        MPI_Barrier(nodeComm);
+        MPI_Win_sync(win);
+        perms = base;
+    }
+
+    void close() {
+        if (win == MPI_WIN_NULL) return;
+        MPI_Win_unlock_all(win);
+        MPI_Win_free(&win);
+        MPI_Comm_free(&nodeComm);
+        perms = nullptr;
+    }
+};
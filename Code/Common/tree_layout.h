@@ -0,0 +1,95 @@
+#pragma once
+// Unpacked views of a PackedTree for consumers that walk whole trees:
+//   parentArray   - flat parent[v], one uint32 per vertex (root maps to itself)
+//   ChildrenCSR   - children of p are child[offset[p] .. offset[p+1]), ascending
+// Both are built in parallel with no locks and no per-vertex allocation. The
+// CSR index is a counting sort on the parent array: atomic degree counts, a
+// blocked prefix sum, an atomic-cursor scatter, then each segment (at most
+// n-1 children) is sorted so the output does not depend on thread timing.
+// Without OpenMP the pragmas are ignored and everything runs serially.
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "packed_perm.h"
+#include "packed_tree.h"
+
+// perms: the packed vertex table, or nullptr to unrank each vertex.
+template<class Dim>
+std::vector<uint32_t> parentArray(PackedTree tree, const PackedPerm* perms, Dim dim) {
+    std::vector<uint32_t> parent(tree.N);
+    const int64_t N = (int64_t)tree.N;
+    #pragma omp parallel for schedule(static)
+    for (int64_t v = 0; v < N; ++v) {
+        int j = tree.swapPos(v);
+        if (j == ROOT_SWAP) { parent[v] = (uint32_t)v; continue; }
+        PackedPerm pv = perms ? perms[v] : unrankPacked((uint64_t)v, dim);
+        parent[v] = (uint32_t)rankAfterSwap(pv, (uint64_t)v, j, dim);
+    }
+    return parent;
+}
+
+struct ChildrenCSR {
+    std::vector<uint64_t> offset;                // N+1 entries
+    std::vector<uint32_t> child;                 // N-1 entries, grouped by parent
+
+    const uint32_t* begin(uint64_t p) const { return child.data() + offset[p]; }
+    const uint32_t* end(uint64_t p) const { return child.data() + offset[p + 1]; }
+};
+
+inline ChildrenCSR buildChildrenCSR(const std::vector<uint32_t>& parent) {
+    const int64_t N = (int64_t)parent.size();
+    ChildrenCSR csr;
+    csr.offset.assign(N + 1, 0);
+
+    // degree of every parent, stored one slot to the right
+    #pragma omp parallel for schedule(static)
+    for (int64_t v = 0; v < N; ++v) {
+        if (parent[v] == (uint32_t)v) continue;
+        #pragma omp atomic
+        csr.offset[parent[v] + 1]++;
+    }
+
+    // inclusive scan of offset[1..N]: per-thread block sums, then fix-up
+    int nThreads = 1;
+#ifdef _OPENMP
+    nThreads = omp_get_max_threads();
+#endif
+    std::vector<uint64_t> blockSum(nThreads + 1, 0);
+    #pragma omp parallel num_threads(nThreads)
+    {
+        int tid = 0, nt = 1;
+#ifdef _OPENMP
+        tid = omp_get_thread_num();
+        nt = omp_get_num_threads();
+#endif
+        int64_t lo = 1 + N * tid / nt, hi = 1 + N * (tid + 1) / nt;
+        uint64_t s = 0;
+        for (int64_t i = lo; i < hi; ++i) s = (csr.offset[i] += s);
+        blockSum[tid + 1] = s;
+        #pragma omp barrier
+        #pragma omp single
+        for (int k = 1; k <= nt; ++k) blockSum[k] += blockSum[k - 1];
+        uint64_t add = blockSum[tid];
+        for (int64_t i = lo; i < hi; ++i) csr.offset[i] += add;
+    }
+
+    // scatter with one cursor per parent, then order each short segment
+    csr.child.resize(csr.offset[N]);
+    std::vector<uint64_t> cursor(csr.offset.begin(), csr.offset.end() - 1);
+    #pragma omp parallel for schedule(static)
+    for (int64_t v = 0; v < N; ++v) {
+        if (parent[v] == (uint32_t)v) continue;
+        uint64_t slot;
+        #pragma omp atomic capture
+        slot = cursor[parent[v]]++;
+        csr.child[slot] = (uint32_t)v;
+    }
+    #pragma omp parallel for schedule(static)
+    for (int64_t p = 0; p < N; ++p)
+        std::sort(csr.child.begin() + csr.offset[p], csr.child.begin() + csr.offset[p + 1]);
+    return csr;
+}
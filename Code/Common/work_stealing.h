@@ -0,0 +1,91 @@
+#pragma once
+// Dynamic scheduling of the (tree, vertex) line (see decomposition.h) across
+// MPI ranks. The line is cut into CHUNK_ITEMS-sized chunks and every rank
+// starts with an equal contiguous run of them as its queue. The queue lives
+// in a one-word RMA window on its owner:
+//
+//     word = end << 32 | next        (end signed, next unsigned)
+//
+// The owner takes chunks from the front with MPI_Fetch_and_op(+1); idle
+// ranks steal from the back with MPI_Fetch_and_op(-(1 << 32)). Both return
+// the old word, so a take is valid iff next < end at that instant, and the
+// two ends can never hand out the same chunk. Thieves visit victims round
+// robin and drop a victim once its queue is empty.
+//
+// Calls are not thread-safe: OpenMP threads share one scheduler per rank
+// and must serialize next() (MPI_THREAD_SERIALIZED is enough).
+
+#include <mpi.h>
+#include <cstdint>
+#include <vector>
+#include "decomposition.h"
+
+static const uint64_t CHUNK_ITEMS = 1 << 15;     // even, multiple of PARENT_BATCH
+
+struct ChunkScheduler {
+    MPI_Comm comm;
+    MPI_Win win;
+    int64_t* word = nullptr;
+    int rank = 0, size = 1;
+    uint64_t totalItems = 0, nChunks = 0;
+    bool ownDone = false;
+    int stealsLeft = 0, victim = 0;              // victims not yet found empty
+
+    ChunkScheduler(uint64_t totalItems_, MPI_Comm comm_) : comm(comm_), totalItems(totalItems_) {
+        MPI_Comm_rank(comm, &rank);
+        MPI_Comm_size(comm, &size);
+        nChunks = (totalItems + CHUNK_ITEMS - 1) / CHUNK_ITEMS;
+        MPI_Win_allocate(sizeof(int64_t), sizeof(int64_t), MPI_INFO_NULL, comm, &word, &win);
+        *word = (int64_t)(firstChunk(rank + 1) << 32) | (int64_t)firstChunk(rank);
+        MPI_Barrier(comm);
+        MPI_Win_lock_all(0, win);
+        stealsLeft = size - 1;
+        victim = (rank + 1) % size;
+    }
+
+    ~ChunkScheduler() { close(); }
+
+    // Collective over comm; must run before MPI_Finalize.
+    void close() {
+        if (!word) return;
+        MPI_Win_unlock_all(win);
+        MPI_Win_free(&win);
+        word = nullptr;
+    }
+
+    // First chunk of rank r's initial queue (r == size gives the end).
+    uint64_t firstChunk(int r) const {
+        return (uint64_t)((unsigned __int128)nChunks * (uint64_t)r / (uint64_t)size);
+    }
+
+    uint64_t chunkBegin(uint64_t c) const { return c * CHUNK_ITEMS; }
+    uint64_t chunkEnd(uint64_t c) const { return std::min(totalItems, (c + 1) * CHUNK_ITEMS); }
+
+    // Next chunk for this rank, or -1 once every queue is empty. `stolen` is
+    // set when the chunk came from another rank's queue.
+    int64_t next(bool& stolen) {
+        while (!ownDone) {
+            int64_t old = fetchAdd(rank, 1);
+            int64_t nxt = old & 0xFFFFFFFF, end = old >> 32;
+            if (nxt < end) { stolen = false; return nxt; }
+            ownDone = true;
+        }
+        while (stealsLeft > 0) {
+            int64_t old = fetchAdd(victim, -((int64_t)1 << 32));
+            int64_t nxt = old & 0xFFFFFFFF, end = old >> 32;
+            if (nxt < end) { stolen = true; return end - 1; }
+            --stealsLeft;
+            victim = (victim + 1) % size;
+            if (victim == rank) victim = (victim + 1) % size;
+        }
+        return -1;
+    }
+
+private:
+    int64_t fetchAdd(int target, int64_t delta) {
+        int64_t old;
+        MPI_Fetch_and_op(&delta, &old, MPI_INT64_T, target, 0, MPI_SUM, win);
+        MPI_Win_flush(target, win);
+        return old;
+    }
+};
@@ -1,74 +1,58 @@
 #include <bits/stdc++.h>
 #include <mpi.h>
 #include <omp.h>
+#include "../Common/perm_rank.h"
+#include "../Common/packed_perm.h"
+#include "../Common/ist_rules.h"
+#include "../Common/rule_table.h"
+#include "../Common/dispatch_n.h"
+#include "../Common/batch_kernel.h"
+#include "../Common/gray_kernel.h"
+#include "../Common/mist_stream.h"
+#include "../Common/mist_checkpoint.h"
+#include "../Common/packed_tree.h"
+#include "../Common/tree_layout.h"
+#include "../Common/perm_gen.h"
+#include "../Common/decomposition.h"
+#include "../Common/shared_tables.h"
+#include "../Common/mist_mpi_io.h"
+#include "../Common/mist_mmap.h"
+#include "../Common/mist_cache.h"
+#include "../Common/ist_verify_mpi.h"
+#include "../Common/phase_timer_mpi.h"
+#include "../Common/instrument_mpi.h"
 using namespace std;
 
 // Hybrid MPI+OpenMP construction of n-1 independent spanning trees (ISTs)
 // of bubble-sort network B_n, using compact data types to reduce memory.
 
-static vector< vector<uint8_t> > perms;      // all vertices, each permutation symbol in [1..n]
-static vector< vector<uint8_t> > pos;        // pos[v][symbol] = index of symbol in perms[v]
-static vector<uint8_t> firstWrong;           // firstWrong[v] = first wrong-from-right position, 1-based
-static vector<uint8_t> root;                 // identity permutation [1..n]
-
-vector< vector<uint8_t> > generatePermutations(int n) {
-    vector<uint8_t> base(n);
-    iota(base.begin(), base.end(), 1);
-    vector<vector<uint8_t>> all;
-    do all.push_back(base);
-    while(next_permutation(base.begin(), base.end()));
-    return all;
-}
-
-string permToString(const vector<uint8_t>& p) {
-    string s;
-    s.reserve(p.size());
-    for (uint8_t x : p) s.push_back(char('0' + x));
-    return s;
-}
+static PackedPerm root;                      // identity permutation [1..n]
 
-void preprocess(int n) {
-    size_t N = perms.size();
-    for (size_t v = 0; v < N; ++v) {
-        auto &P = perms[v];
-        for (int j = 0; j < n; ++j)
-            pos[v][ P[j] ] = (uint8_t)j;
-        int r;
-        for (r = n - 1; r >= 0; --r) if (P[r] != r+1) break;
-        firstWrong[v] = (r <= 0 ? 1 : (uint8_t)r);
+// Tn_t.dot from the tree's CSR children index (perms may be nullptr: unrank).
+void writeDotFile(PackedTree tree, int n, int t, const PackedPerm* perms, PhaseTimer& timer) {
+    timer.start(PHASE_INDEX);
+    ChildrenCSR csr = buildChildrenCSR(parentArray(tree, perms, n));
+    timer.start(PHASE_EXPORT);
+    ofstream dot("Tn_"+to_string(t)+".dot");
+    dot<<"digraph T"<<n<<"_"<<t<<" {\n  rankdir=TB;\n";
+    for (uint64_t p=0; p<tree.N; ++p) {
+        if (csr.begin(p) == csr.end(p)) continue;
+        string pLabel = permToString(unrankPacked(p, n), n);
+        for (const uint32_t* c = csr.begin(p); c != csr.end(p); ++c)
+            dot<<"  \""<<pLabel<<"\" -> \""<<permToString(unrankPacked(*c, n), n)<<"\";\n";
     }
+    dot<<"}\n";
 }
 
-vector<uint8_t> swapAdjacent(size_t vIdx, uint8_t symbol) {
-    auto v = perms[vIdx];
-    int j = pos[vIdx][symbol];
-    if (j < 0 || j + 1 >= (int)v.size()) return v;
-    swap(v[j], v[j+1]);
-    return v;
-}
-
-vector<uint8_t> findPosition(size_t vIdx, int t, int n) {
-    auto v = perms[vIdx];
-    auto u = swapAdjacent(vIdx, (uint8_t)t);
-    if (t == 2 && u == root) return swapAdjacent(vIdx, (uint8_t)(t-1));
-    uint8_t vn1 = v[n-2];
-    if (vn1 == t || vn1 == n-1) return swapAdjacent(vIdx, (uint8_t)(firstWrong[vIdx] + 1));
-    return u;
-}
-
-vector<uint8_t> parent1(size_t vIdx, int t, int n) {
-    auto v = perms[vIdx];
-    uint8_t vn = v[n-1], vn1 = v[n-2];
-    if (vn == n) {
-        return (t != n-1 ? findPosition(vIdx, t, n)
-                         : swapAdjacent(vIdx, vn1));
-    }
-    if (vn == n-1 && vn1 == n && swapAdjacent(vIdx, (uint8_t)n) != root) {
-        return (t == 1 ? swapAdjacent(vIdx, (uint8_t)n)
-                       : swapAdjacent(vIdx, (uint8_t)(t-1)));
+// Spanning/independence check split over all ranks; false on failure.
+bool verifyForest(const vector<PackedTree>& trees, int n, int rank) {
+    double start = MPI_Wtime();
+    VerifyReport rep = verifyTreesMPI(trees, n, MPI_COMM_WORLD);
+    if (rank == 0) {
+        cout << "Verify (" << MPI_Wtime() - start << " s):\n";
+        printVerifyReport(rep, cout);
     }
-    return (vn == t ? swapAdjacent(vIdx, (uint8_t)n)
-                    : swapAdjacent(vIdx, (uint8_t)t));
+    return rep.ok();
 }
 
 int main(int argc, char** argv) {
@@ -79,112 +63,278 @@ int main(int argc, char** argv) {
 
     // start timing
     double t_start = MPI_Wtime();
+    PhaseTimer timer;
 
-    if (argc != 2) {
-        if (rank == 0) cerr << "Usage: " << argv[0] << " <n (2<=n<=10)>\n";
+    // --implicit: unrank each vertex on the fly instead of building the perms table
+    // --gray: walk the vertices in Gray-code order with O(1) updates (no perms table)
+    // --stream: build block by block straight to the files, in bounded memory (n <= 14)
+    // --resume: --stream, skipping the blocks the last run's checkpoint records
+    // --checkpoint <s>: seconds between --stream checkpoints
+    // --dot: gather on rank 0 and write Tn_t.dot instead of collective Tn_t.mist
+    // --cache <dir>: reuse the trees cached for this n, else build and cache them
+    // --verify: check the trees are spanning and independent (exit code 1 if not)
+    bool implicit = false, gray = false, stream = false, resume = false, dotExport = false, verify = false,
+         badArgs = (argc < 2);
+    double checkpointSeconds = CHECKPOINT_SECONDS;
+    string cacheRoot;
+    for (int i = 2; i < argc; ++i) {
+        string a = argv[i];
+        if (a == "--implicit") implicit = true;
+        else if (a == "--gray") gray = true;
+        else if (a == "--stream") stream = true;
+        else if (a == "--resume") stream = resume = true;
+        else if (a == "--checkpoint" && i + 1 < argc) checkpointSeconds = stod(argv[++i]);
+        else if (a == "--dot") dotExport = true;
+        else if (a == "--cache" && i + 1 < argc) cacheRoot = argv[++i];
+        else if (a == "--verify") verify = true;
+        else badArgs = true;
+    }
+    if (badArgs) {
+        if (rank == 0) cerr << "Usage: " << argv[0] << " <n> [--implicit] [--gray] [--stream] [--resume] [--checkpoint <s>]"
+                             " [--dot] [--cache <dir>] [--verify]\n";
         MPI_Finalize(); return 1;
     }
+    if (stream && (dotExport || verify)) {
+        if (rank == 0) cerr << "--dot and --verify need the trees in memory and cannot be used with --stream\n";
+        MPI_Finalize(); return 1;
+    }
+    implicit = implicit || gray || stream;
     int n = stoi(argv[1]);
-    if (n < 2 || n > 10) {
-        if (rank == 0) cerr << "n must be in range [2..10]\n";
+    int maxN = stream ? MAX_STREAM_N : implicit ? MAX_IMPLICIT_N : MAX_TABLE_N;
+    if (n < 2 || n > maxN) {
+        if (rank == 0) cerr << "n must be in range [2.." << maxN << "]\n";
         MPI_Finalize(); return 1;
     }
 
-    // Generate permutations and setup
-    perms = generatePermutations(n);
-    size_t N = perms.size();
-    root.resize(n);
-    iota(root.begin(), root.end(), 1);
-    pos.assign(N, vector<uint8_t>(n+1));
-    firstWrong.assign(N, 1);
-    preprocess(n);
-
-    unordered_map<string,int> indexOf;
-    indexOf.reserve(N);
-    for (size_t i = 0; i < N; ++i)
-        indexOf[ permToString(perms[i]) ] = (int)i;
+    // Cache lookup on rank 0: a hit maps the stored trees and skips the build
+    string cacheDir = cacheRoot.empty() ? "" : mistCacheDir(cacheRoot, n);
+    int cacheHit = 0, cacheDirOk = 1;
+    MappedForest cached;
+    if (rank == 0 && !cacheDir.empty()) {
+        string err;
+        timer.start(PHASE_LOAD);
+        cacheHit = cached.open(cacheDir, n, err);
+        timer.stop();
+        if (!cacheHit && !makeMistCacheDir(cacheDir)) {
+            cerr << "Cannot create " << cacheDir << "\n";
+            cacheDirOk = 0;
+        }
+    }
+    MPI_Bcast(&cacheDirOk, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    if (!cacheDirOk) {
+        MPI_Finalize(); return 1;
+    }
+    MPI_Bcast(&cacheHit, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    if (cacheHit) {
+        if (rank == 0) {
+            cout << "Loaded " << n-1 << " trees from " << cacheDir << endl;
+            if (dotExport)
+                for (int t = 1; t <= n-1; ++t) writeDotFile(cached.tree(t), n, t, nullptr, timer);
+            timer.stop();
+            cout << "Time taken (longest): " << (MPI_Wtime() - t_start) << " seconds\n";
+        }
+        // rank 0 sends the mapped trees to every rank for the check
+        bool ok = true;
+        if (verify) {
+            timer.start(PHASE_VERIFY);
+            PackedForest copy;
+            if (rank != 0) copy = PackedForest(n);
+            vector<PackedTree> trees;
+            for (int t = 1; t <= n-1; ++t) {
+                trees.push_back(rank == 0 ? cached.tree(t) : copy.tree(t));
+                MPI_Bcast(trees.back().bytes, (int)trees.back().byteSize(), MPI_BYTE, 0, MPI_COMM_WORLD);
+            }
+            ok = verifyForest(trees, n, rank);
+        }
+        printPhasesMPI(timer, MPI_COMM_WORLD, cout);
+        MPI_Finalize();
+        return ok ? 0 : 1;
+    }
 
-    int T = n - 1;
-    int per = T / size, rem = T % size;
-    int start_t = (rank < rem ? rank*(per+1)+1 : rem*(per+1)+(rank-rem)*per+1);
-    int end_t   = (rank < rem ? start_t+per : start_t+per-1);
-    vector<int> assigned_t;
-    for (int t = start_t; t <= end_t; ++t) assigned_t.push_back(t);
+    // Setup
+    size_t N = FACT[n];
+    root = PackedPerm::identity(n);
 
-    size_t M = assigned_t.size() * N;
-    vector<tuple<int,uint32_t,uint32_t>> edges;
+    // vertex index == lexicographic rank of its permutation
+    uint64_t rootIdx = rankPacked(root, n);
 
-    #pragma omp parallel
-    {
-        vector<tuple<int,uint32_t,uint32_t>> buf;
-        #pragma omp for nowait
-        for (size_t i = 0; i < M; ++i) {
-            int li = i / N;
-            uint32_t vIdx = i % N;
-            if (vIdx == (uint32_t)indexOf[permToString(root)]) continue;
-            int t = assigned_t[li];
-            vector<uint8_t> p = parent1(vIdx, t, n);
-            uint32_t pIdx = indexOf[ permToString(p) ];
-            buf.emplace_back(li, pIdx, vIdx);
+    // Out of core: the blocks still to build are split into contiguous runs,
+    // one per rank, and each rank builds its blocks for all trees at once.
+    // Ranks write in lockstep rounds (collective writes), an idle rank
+    // joining with nothing to write. Every checkpointSeconds (rank 0's clock)
+    // the files are synced and the ranks' finished blocks OR-ed into rank 0's
+    // checkpoint. Blocks do not depend on the rank count, so --resume may use
+    // any number of ranks.
+    if (stream) {
+        timer.start(PHASE_PREPROCESS);
+        RuleTable rules(n);
+        StreamBlockBuilder builder(n, gray);
+        uint64_t blocks = streamBlockCount(n);
+        StreamCheckpoint checkpoint(n, STREAM_BLOCK, blocks);
+        int keep = 0;
+        if (rank == 0) {
+            string err;
+            keep = resume && checkpoint.load(cacheDir, err);
+            if (keep) cout << "Resuming: " << checkpoint.doneCount() << " of " << blocks << " blocks already written" << endl;
+            else if (resume) cout << "Starting over: " << err << endl;
+            if (!keep) remove(checkpointPath(cacheDir).c_str());   // stale once the blocks are rebuilt
+        }
+        MPI_Bcast(&keep, 1, MPI_INT, 0, MPI_COMM_WORLD);
+        MPI_Bcast(checkpoint.done.data(), (int)checkpoint.done.size(), MPI_UNSIGNED_CHAR, 0, MPI_COMM_WORLD);
+        MistStreamMPI files;
+        bool ok = files.open(n, cacheDir, MPI_COMM_WORLD);
+        vector<uint64_t> todo = checkpoint.pending();
+        uint64_t P = todo.size();
+        uint64_t first = P * rank / size, last = P * (rank + 1) / size;
+        uint64_t rounds = (P + size - 1) / size;
+        if (rank == 0) cout << "Streaming " << N << " vertices in " << blocks << " blocks" << endl;
+        double lastCheckpoint = wallSeconds();
+        for (uint64_t i = 0; i < rounds && ok; ++i) {
+            uint64_t lo = 0, hi = 0;
+            size_t bytes = 0;
+            if (first + i < last) {
+                streamBlockRange(n, todo[first + i], lo, hi);
+                timer.start(PHASE_BUILD);
+                dispatchN(n, [&](auto nc) { bytes = builder.build(rules, nc, lo, hi, rootIdx); });
+            }
+            timer.start(PHASE_EXPORT);
+            for (int t = 1; t <= n-1 && ok; ++t) ok = files.write(t, lo / 2, builder.out[t-1].data(), bytes);
+            if (!ok) break;                      // ok is the same on every rank
+            if (first + i < last) checkpoint.markDone(todo[first + i]);
+            int due = rank == 0 && wallSeconds() - lastCheckpoint >= checkpointSeconds;
+            MPI_Bcast(&due, 1, MPI_INT, 0, MPI_COMM_WORLD);
+            if (due) {
+                if (!(ok = files.sync())) break;
+                MPI_Reduce(rank == 0 ? MPI_IN_PLACE : checkpoint.done.data(), checkpoint.done.data(),
+                           (int)checkpoint.done.size(), MPI_UNSIGNED_CHAR, MPI_BOR, 0, MPI_COMM_WORLD);
+                if (rank == 0 && !checkpoint.save(cacheDir)) cerr << "Cannot write " << checkpointPath(cacheDir) << "\n";
+                lastCheckpoint = wallSeconds();
+            }
+            if (rank == 0 && (i + 1) * 10 / rounds != i * 10 / rounds)
+                cout << "  " << (i + 1) * 100 / rounds << "% (" << i + 1 << " rounds)" << endl;
+        }
+        ok = files.close(ok) && ok;
+        if (!ok && rank == 0) cerr << "Cannot write the tree files\n";
+        if (ok && rank == 0) remove(checkpointPath(cacheDir).c_str());   // the headers now mark the files complete
+        timer.stop();
+        {
+            CommWait wait;
+            MPI_Barrier(MPI_COMM_WORLD);
         }
-        #pragma omp critical
-        edges.insert(edges.end(), buf.begin(), buf.end());
+        if (rank == 0) cout << "Time taken (longest): " << (MPI_Wtime() - t_start) << " seconds\n";
+        printPhasesMPI(timer, MPI_COMM_WORLD, cout);
+        printInstrumentMPI(rules, MPI_COMM_WORLD, cout);
+        MPI_Finalize();
+        return ok ? 0 : 1;
     }
 
-    // Build local and send to root
-    if (rank == 0) {
-        vector<vector<vector<uint32_t>>> children_global(T, vector<vector<uint32_t>>(N));
-        // own
-        for (auto &e : edges) {
-            int li; uint32_t p,v;
-            tie(li,p,v) = e;
-            int t = assigned_t[li] - 1;
-            children_global[t][p].push_back(v);
-        }
-        // receive others
-        for (int src = 1; src < size; ++src) {
-            int pst = (src < rem ? src*(per+1)+1 : rem*(per+1)+(src-rem)*per+1);
-            int pen = (src < rem ? pst+per : pst+per-1);
-            for (int t = pst; t <= pen; ++t) {
-                int tIdx = t-1;
-                int cnt;
-                MPI_Recv(&cnt,1,MPI_INT,src,t, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-                vector<uint32_t> buf(2*cnt);
-                MPI_Recv(buf.data(),2*cnt,MPI_UINT32_T,src,t+T, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-                for (int k=0; k<cnt; ++k)
-                    children_global[tIdx][ buf[2*k] ].push_back(buf[2*k+1]);
+    // Vertex table: one copy per node in shared memory, filled by all local ranks
+    timer.start(PHASE_GENERATE);
+    NodeSharedPerms vertexTable;
+    if (!implicit) vertexTable = NodeSharedPerms(n, MPI_COMM_WORLD);
+    const PackedPerm* perms = vertexTable.perms;
+
+    // 2D decomposition: this rank's slice of the (tree, vertex) line, as one
+    // tile per tree it touches
+    timer.start(PHASE_PREPROCESS);
+    int T = n - 1;
+    vector<Tile> tiles = sliceTiles(n, rank, size);
+
+    // Packed output: each rank holds just its slice, padded to whole FOREST_PAD
+    // units. For --dot, rank 0 instead holds the whole forest and fills its own
+    // slice in place; for --verify every rank does.
+    uint64_t sliceLo, sliceHi;
+    sliceItems(n, rank, size, sliceLo, sliceHi);
+    bool wholeForest = (dotExport && rank == 0) || verify;
+    PackedForest forest;
+    vector<uint8_t> sliceBytes;
+    if (wholeForest) forest = PackedForest(n);
+    else sliceBytes.resize(((sliceHi - sliceLo) / 2 + FOREST_PAD - 1) / FOREST_PAD * FOREST_PAD);
+    vector<uint8_t*> tileOut(tiles.size());
+    for (size_t k = 0; k < tiles.size(); ++k) {
+        uint64_t first = (uint64_t)(tiles[k].t - 1) * N + tiles[k].vBegin;
+        tileOut[k] = wholeForest ? forest.itemBytes(first) : sliceBytes.data() + ((first - sliceLo) >> 1);
+    }
+
+    // parent rules as a lookup table; kernel instantiated for the concrete n.
+    // Work items are batches of PARENT_BATCH consecutive vertices of a tile
+    // (--gray: the part of one Gray-code block inside the tile); each item
+    // fills whole bytes of its tile, so threads write without locking.
+    RuleTable rules(n);
+    const uint64_t B = grayBlockSize(n);
+    vector<size_t> firstBatch(tiles.size() + 1, 0);
+    for (size_t k = 0; k < tiles.size(); ++k)
+        firstBatch[k+1] = firstBatch[k] + (gray ? (tiles[k].vEnd - 1) / B - tiles[k].vBegin / B + 1
+                                                : (tiles[k].size() + PARENT_BATCH - 1) / PARENT_BATCH);
+    size_t MB = firstBatch[tiles.size()];
+    timer.start(PHASE_BUILD);
+    dispatchN(n, [&](auto nc) {
+        #pragma omp parallel
+        {
+            uint8_t swapPos[PARENT_BATCH];
+            uint64_t parentRank[PARENT_BATCH];
+            #pragma omp for
+            for (size_t i = 0; i < MB; ++i) {
+                size_t k = upper_bound(firstBatch.begin(), firstBatch.end(), i) - firstBatch.begin() - 1;
+                const Tile& tile = tiles[k];
+                if (gray) {
+                    uint64_t lo = max(tile.vBegin, (tile.vBegin / B + (i - firstBatch[k])) * B);
+                    uint64_t hi = min(tile.vEnd, (lo / B + 1) * B);
+                    grayFillRange(rules, tile.t, nc, lo, hi, tileOut[k] + ((lo - tile.vBegin) >> 1), rootIdx);
+                    continue;
+                }
+                uint64_t vBase = tile.vBegin + (i - firstBatch[k]) * PARENT_BATCH;
+                int count = (int)min<uint64_t>(PARENT_BATCH, tile.vEnd - vBase);
+                batchParents(rules, tile.t, nc, vBase, count, implicit ? nullptr : perms + vBase,
+                             swapPos, parentRank);
+                packSwapBatch(tileOut[k] + ((vBase - tile.vBegin) >> 1), vBase, count, swapPos, rootIdx);
             }
         }
-        // export
-        
-        for (int t=1; t<=T; ++t) {
-            ofstream dot("Tn_"+to_string(t)+".dot");
-            dot<<"digraph T"<<n<<"_"<<t<<" {\n  rankdir=TB;\n";
-            for (uint32_t p=0; p<N; ++p)
-                for (auto c: children_global[t-1][p])
-                    dot<<"  \""<<permToString(perms[p])<<"\" -> \""<<permToString(perms[c])<<"\";\n";
-            dot<<"}\n";
-        }
-            
-    } else {
-        // send edges
-        vector<vector<uint32_t>> buf(assigned_t.size());
-        vector<int> cnt(assigned_t.size());
-        for (auto &e : edges) {
-            int li; uint32_t p,v;
-            tie(li,p,v) = e;
-            buf[li].push_back(p);
-            buf[li].push_back(v);
+    });
+
+    // Default export: every rank writes its own tiles into Tn_t.mist with
+    // collective MPI-IO; nothing is gathered. A cache always gets the files.
+    timer.start(PHASE_EXPORT);
+    bool written = true;
+    if (!dotExport || !cacheDir.empty()) written = writeMistCollective(n, tiles, tileOut, cacheDir, MPI_COMM_WORLD);
+    if (!written && rank == 0) cerr << "Cannot write the tree files\n";
+
+    // --dot: gather every slice into rank 0's forest at its offset in one
+    // collective (--verify: into every rank's forest). Counts and
+    // displacements are in FOREST_PAD-byte units so they stay within int for
+    // the largest n.
+    if (dotExport || verify) {
+        timer.start(PHASE_GATHER);
+        MPI_Datatype unit;
+        MPI_Type_contiguous((int)FOREST_PAD, MPI_BYTE, &unit);
+        MPI_Type_commit(&unit);
+        vector<int> counts(size), displs(size);
+        for (int r = 0; r < size; ++r) {
+            uint64_t lo, hi;
+            sliceItems(n, r, size, lo, hi);
+            counts[r] = (int)(((hi - lo) / 2 + FOREST_PAD - 1) / FOREST_PAD);
+            displs[r] = (int)(lo / 2 / FOREST_PAD);
         }
-        for (int i=0; i<assigned_t.size(); ++i) {
-            int t = assigned_t[i];
-            cnt[i] = buf[i].size()/2;
-            MPI_Send(&cnt[i],1,MPI_INT,0,t, MPI_COMM_WORLD);
-            MPI_Send(buf[i].data(),2*cnt[i],MPI_UINT32_T,0,t+T, MPI_COMM_WORLD);
+        {
+            CommWait wait;
+            if (verify)
+                MPI_Allgatherv(MPI_IN_PLACE, 0, unit, forest.bytes.data(), counts.data(), displs.data(), unit, MPI_COMM_WORLD);
+            else if (rank == 0)
+                MPI_Gatherv(MPI_IN_PLACE, 0, unit, forest.bytes.data(), counts.data(), displs.data(), unit, 0, MPI_COMM_WORLD);
+            else
+                MPI_Gatherv(sliceBytes.data(), counts[rank], unit, nullptr, nullptr, nullptr, unit, 0, MPI_COMM_WORLD);
         }
+        MPI_Type_free(&unit);
+
+        if (dotExport && rank == 0)
+            for (int t = 1; t <= T; ++t) writeDotFile(forest.tree(t), n, t, perms, timer);
     }
+    timer.stop();
 
-    MPI_Barrier(MPI_COMM_WORLD);
+    {
+        CommWait wait;
+        MPI_Barrier(MPI_COMM_WORLD);
+    }
 
     // end timing
     double t_end = MPI_Wtime();
@@ -195,6 +345,17 @@ int main(int argc, char** argv) {
         cout << "Time taken (longest): " << max_elapsed << " seconds\n";
     }
 
+    bool ok = written;
+    if (verify) {
+        vector<PackedTree> trees;
+        for (int t = 1; t <= T; ++t) trees.push_back(forest.tree(t));
+        timer.start(PHASE_VERIFY);
+        ok = verifyForest(trees, n, rank) && ok;
+    }
+    printPhasesMPI(timer, MPI_COMM_WORLD, cout);
+    printInstrumentMPI(rules, MPI_COMM_WORLD, cout);
+
+    vertexTable.close();
     MPI_Finalize();
-    return 0;
+    return ok ? 0 : 1;
 }
@@ -1,148 +1,138 @@
 #include <bits/stdc++.h>
 #include <mpi.h>
 #include <omp.h>
+#include "../Common/perm_rank.h"
+#include "../Common/packed_perm.h"
+#include "../Common/ist_rules.h"
+#include "../Common/rule_table.h"
+#include "../Common/dispatch_n.h"
+#include "../Common/batch_kernel.h"
+#include "../Common/gray_kernel.h"
+#include "../Common/packed_tree.h"
+#include "../Common/perm_gen.h"
+#include "../Common/decomposition.h"
+#include "../Common/work_stealing.h"
+#include "../Common/pipeline.h"
+#include "../Common/shared_tables.h"
+#include "../Common/mist_format.h"
+#include "../Common/mist_mmap.h"
+#include "../Common/mist_cache.h"
+#include "../Common/ist_verify_mpi.h"
+#include "../Common/phase_timer_mpi.h"
+#include "../Common/instrument_mpi.h"
 using namespace std;
 
 // Parallel construction of ISTs of bubble-sort network B_n
 // Fixed worker-master communication for better load distribution
 
-static vector<vector<uint8_t>> perms;
-static vector<vector<uint8_t>> pos;
-static vector<uint8_t> firstWrong;
-static vector<uint8_t> root;
+static PackedPerm root;
 
-vector<vector<uint8_t>> generatePermutations(int n) {
-    // Pre-calculate factorial size to avoid resizing
-    int factorial = 1;
-    for(int i = 2; i <= n; i++) {
-        factorial *= i;
+// Spanning/independence check: the master's trees (masterTrees, empty on
+// workers) are broadcast and every process checks its share; false on failure.
+bool verifyForest(const vector<PackedTree>& masterTrees, int n, int rank) {
+    double start = MPI_Wtime();
+    PackedForest copy;
+    if (rank != 0) copy = PackedForest(n);
+    vector<PackedTree> trees;
+    for (int t = 1; t <= n-1; ++t) {
+        trees.push_back(rank == 0 ? masterTrees[t-1] : copy.tree(t));
+        MPI_Bcast(trees.back().bytes, (int)trees.back().byteSize(), MPI_BYTE, 0, MPI_COMM_WORLD);
     }
-    
-    vector<uint8_t> base(n);
-    iota(base.begin(), base.end(), 1);
-    
-    // Pre-allocate the exact space needed
-    vector<vector<uint8_t>> all;
-    all.reserve(factorial);
-    
-    // More efficient insertion
-    do {
-        all.push_back(base);
-    } while (next_permutation(base.begin(), base.end()));
-    
-    return all;
-}
-
-string permToString(const vector<uint8_t>& p) {
-    // Faster string construction with single allocation
-    string s;
-    s.reserve(p.size());
-    for (uint8_t x : p) {
-        s.push_back(char('0' + x));
-    }
-    return s;
-}
-
-void preprocess(int n) {
-    size_t N = perms.size();
-    
-    // Use different schedulers for better performance
-    #pragma omp parallel for schedule(static)
-    for (size_t v = 0; v < N; ++v) {
-        auto &P = perms[v];
-        // Optimized inner loop - unrolled for small n
-        if (n <= 8) {
-            for (int j = 0; j < n; ++j) {
-                pos[v][P[j]] = (uint8_t)j;
-            }
-        } else {
-            // Vectorizable loop for larger n
-            for (int j = 0; j < n; ++j) {
-                pos[v][P[j]] = (uint8_t)j;
-            }
-        }
-        
-        // More efficient first wrong computation
-        int r = n - 1;
-        while (r >= 0 && P[r] == r+1) r--;
-        firstWrong[v] = (r < 0 ? 1 : (uint8_t)r);
-    }
-}
-
-// Performance-optimized swap function that reduces object copies
-inline vector<uint8_t> swapAdjacent(size_t vIdx, uint8_t symbol) {
-    const auto& v = perms[vIdx]; 
-    int j = pos[vIdx][symbol];
-    if (j+1 >= (int)v.size()) return v;
-    
-    // Create result with reserved capacity
-    vector<uint8_t> result(v);
-    swap(result[j], result[j+1]); 
-    return result;
-}
-
-// Optimized position finder with reduced redundant computations
-inline vector<uint8_t> findPosition(size_t vIdx, int t, int n) {
-    const auto& v = perms[vIdx]; 
-    auto u = swapAdjacent(vIdx, (uint8_t)t);
-    
-    if (t == 2 && u == root) {
-        return swapAdjacent(vIdx, (uint8_t)(t-1));
-    }
-    
-    uint8_t vn1 = v[n-2];
-    if (vn1 == t || vn1 == n-1) {
-        return swapAdjacent(vIdx, (uint8_t)(firstWrong[vIdx]+1));
+    VerifyReport rep = verifyTreesMPI(trees, n, MPI_COMM_WORLD);
+    if (rank == 0) {
+        cout << "Verify (" << MPI_Wtime() - start << " s):\n";
+        printVerifyReport(rep, cout);
     }
-    
-    return u;
+    return rep.ok();
 }
 
-// Highly optimized parent function with inlining for better performance
-inline vector<uint8_t> parent1(size_t vIdx, int t, int n) {
-    const auto& v = perms[vIdx]; 
-    uint8_t vn = v[n-1], vn1 = v[n-2];
-    
-    if (vn == n) {
-        return (t != n-1) ? findPosition(vIdx, t, n) : swapAdjacent(vIdx, vn1);
-    }
-    
-    if (vn == n-1 && vn1 == n) {
-        auto s = swapAdjacent(vIdx, (uint8_t)n);
-        if (s != root) {
-            return (t == 1) ? s : swapAdjacent(vIdx, (uint8_t)(t-1));
-        }
+int main(int argc,char**argv){
+    // --implicit: unrank each vertex on the fly instead of building the perms table
+    // --gray: walk the vertices in Gray-code order with O(1) updates (no perms table)
+    // --pipeline: stream chunks out through a bounded ring of in-flight puts
+    // --cache <dir>: reuse the trees cached for this n, else build and cache them
+    // --verify: check the trees are spanning and independent (exit code 1 if not)
+    bool implicit = false, gray = false, pipeline = false, verify = false, badArgs = (argc < 2);
+    string cacheRoot;
+    for(int i=2; i<argc; ++i) {
+        string a = argv[i];
+        if(a=="--implicit") implicit = true;
+        else if(a=="--gray") gray = true;
+        else if(a=="--pipeline") pipeline = true;
+        else if(a=="--cache" && i+1<argc) cacheRoot = argv[++i];
+        else if(a=="--verify") verify = true;
+        else badArgs = true;
     }
-    
-    return (vn == t) ? swapAdjacent(vIdx, (uint8_t)n) : swapAdjacent(vIdx, (uint8_t)t);
-}
 
-int main(int argc,char**argv){
-    MPI_Init(&argc,&argv);
+    // OpenMP threads take turns calling MPI (chunk requests and sends); the
+    // pipelined mode puts from every thread and runs a progress thread
+    int provided;
+    MPI_Init_thread(&argc,&argv,pipeline ? MPI_THREAD_MULTIPLE : MPI_THREAD_SERIALIZED,&provided);
     double t_start = MPI_Wtime();
+    PhaseTimer timer;
 
     int rank,size;
     MPI_Comm_rank(MPI_COMM_WORLD,&rank);
     MPI_Comm_size(MPI_COMM_WORLD,&size);
 
-    if(argc!=2){ if(rank==0) cerr<<"Usage: "<<argv[0]<<" <n>\n"; MPI_Finalize(); return 1; }
-    int n=stoi(argv[1]); if(n<2||n>10){ if(rank==0) cerr<<"n must be [2..10]\n"; MPI_Finalize(); return 1; }
+    if(badArgs){ if(rank==0) cerr<<"Usage: "<<argv[0]<<" <n> [--implicit] [--gray] [--pipeline] [--cache <dir>] [--verify]\n"; MPI_Finalize(); return 1; }
+    implicit = implicit || gray;
+    if(pipeline && provided < MPI_THREAD_MULTIPLE) {
+        if(rank==0) cerr<<"MPI_THREAD_MULTIPLE not available, running without --pipeline\n";
+        pipeline = false;
+    }
+    int n=stoi(argv[1]); int maxN = implicit ? MAX_IMPLICIT_N : MAX_TABLE_N;
+    if(n<2||n>maxN){ if(rank==0) cerr<<"n must be [2.."<<maxN<<"]\n"; MPI_Finalize(); return 1; }
+
+    // Cache lookup on the master: a hit maps the stored trees and skips the build
+    string cacheDir = cacheRoot.empty() ? "" : mistCacheDir(cacheRoot, n);
+    int cacheHit = 0, cacheDirOk = 1;
+    MappedForest cached;
+    if(rank==0 && !cacheDir.empty()) {
+        string err;
+        timer.start(PHASE_LOAD);
+        cacheHit = cached.open(cacheDir, n, err);
+        timer.stop();
+        if(!cacheHit && !makeMistCacheDir(cacheDir)) { cerr<<"Cannot create "<<cacheDir<<"\n"; cacheDirOk = 0; }
+    }
+    MPI_Bcast(&cacheDirOk, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    if(!cacheDirOk){ MPI_Finalize(); return 1; }
+    MPI_Bcast(&cacheHit, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    if(cacheHit) {
+        if(rank==0) {
+            cout<<"Loaded "<<n-1<<" trees from "<<cacheDir<<endl;
+            cout<<"Total execution time: "<<(MPI_Wtime() - t_start)<<" seconds\n";
+        }
+        bool ok = true;
+        if(verify) {
+            vector<PackedTree> trees;
+            if(rank==0) for(int t=1; t<=n-1; ++t) trees.push_back(cached.tree(t));
+            timer.start(PHASE_VERIFY);
+            ok = verifyForest(trees, n, rank);
+        }
+        printPhasesMPI(timer, MPI_COMM_WORLD, cout);
+        MPI_Finalize();
+        return ok ? 0 : 1;
+    }
 
     if (rank == 0) {
         cout << "Running fixed MIST construction with:" << endl;
         cout << "  Size parameter (n): " << n << endl;
         cout << "  MPI processes: " << size << endl;
         cout << "  OpenMP threads per process: " << omp_get_max_threads() << endl;
+        cout << "  Vertex mode: " << (gray ? "gray" : implicit ? "implicit" : "tables") << endl;
+        cout << "  Transfer: " << (pipeline ? "pipelined" : "blocking") << endl;
     }
 
     // setup
-    perms=generatePermutations(n);
-    size_t N=perms.size();
-    root.resize(n); iota(root.begin(),root.end(),1);
-    pos.assign(N,vector<uint8_t>(n+1)); firstWrong.assign(N,1);
-    preprocess(n);
-    unordered_map<string,int> indexOf; indexOf.reserve(N);
-    for(size_t i=0;i<N;++i) indexOf[permToString(perms[i])] = i;
+    size_t N=FACT[n];
+    root=PackedPerm::identity(n);
+    // vertex index == lexicographic rank of its permutation
+    uint64_t rootIdx = rankPacked(root, n);
+
+    // Parent rules compiled into a lookup table for this n
+    timer.start(PHASE_PREPROCESS);
+    RuleTable rules(n);
 
     // Total number of trees to compute
     int T = n-1;
@@ -151,223 +141,174 @@ int main(int argc,char**argv){
         cout << "Building " << T << " trees for n=" << n << endl;
     }
     
-    // Determine which trees each process will work on
-    vector<int> treesToBuild;
-    for (int t = 1; t <= T; t++) {
-        if (t % size == rank) {
-            treesToBuild.push_back(t);
-        }
+    // master storage: all trees in one packed forest (4-bit swap position
+    // per vertex), exposed as an RMA window that workers write into
+    PackedForest forest;
+    
+    if(rank==0) {
+        forest = PackedForest(n);
+    }
+    // (a single process has no workers and needs no window)
+    MPI_Win resultWin = MPI_WIN_NULL;
+    if (size > 1) {
+        MPI_Win_create(rank==0 ? forest.bytes.data() : nullptr, rank==0 ? (MPI_Aint)forest.bytes.size() : 0,
+                       1, MPI_INFO_NULL, MPI_COMM_WORLD, &resultWin);
+        MPI_Win_lock_all(0, resultWin);
     }
+
+    // The (tree, vertex) line is cut into chunks; each process starts with an
+    // equal run of them and idle processes steal from busy ones
+    uint64_t totalItems = (uint64_t)T * N;
+    ChunkScheduler sched(totalItems, MPI_COMM_WORLD);
+    
+    // Vertex table: one copy per node in shared memory, filled by all local
+    // processes, so stolen chunks can use it as well
+    timer.start(PHASE_GENERATE);
+    NodeSharedPerms vertexTable;
+    if(!implicit) vertexTable = NodeSharedPerms(n, MPI_COMM_WORLD);
+    const PackedPerm* perms = vertexTable.perms;
+    timer.stop();
     
     if (rank == 0) {
-        cout << "Process " << rank << " will build trees: ";
-        for (int t : treesToBuild) cout << t << " ";
-        cout << endl;
+        cout << "Chunks of " << CHUNK_ITEMS << " (tree, vertex) pairs: " << sched.nChunks << endl;
+        cout << "Process " << rank << " starts with chunks [" << sched.firstChunk(rank)
+             << "," << sched.firstChunk(rank+1) << ")" << endl;
     }
     
-    // master storage
-    vector<vector<vector<uint32_t>>> children_global;
-    vector<MPI_Request> recvRequests;
-    vector<vector<uint32_t>> recvBuffers;
+    uint64_t chunksDone = 0, chunksStolen = 0;
     
-    if(rank==0) {
-        children_global.assign(T, vector<vector<uint32_t>>(N));
+    // Pipelined transfer: a progress thread keeps puts moving while every
+    // OpenMP thread computes
+    unique_ptr<ProgressThread> progress;
+    if (pipeline && size > 1) progress.reset(new ProgressThread(MPI_COMM_WORLD));
+    if (pipeline && rank == 0) {
+        cout << "In-flight buffers per worker thread: " << PIPELINE_DEPTH << " x "
+             << CHUNK_ITEMS / 2 << " bytes" << endl;
     }
 
-    // workers send buffer management
-    vector<vector<uint32_t>> sendBuffers;
-    vector<MPI_Request> sendRequests;
-
-    // Build trees assigned to this process
-    for(int i = 0; i < (int)treesToBuild.size(); i++) {
-        int t = treesToBuild[i];
-        
-        // Build the tree locally
-        vector<vector<uint32_t>> children_t(N);
-        for (auto& child_list : children_t) {
-            child_list.reserve(n);
-        }
-        
-        // Compute root index
-        int rootIdx = indexOf[permToString(root)];
-        
-        // Build this tree in parallel using OpenMP
+    // Kernel is instantiated for the concrete n by dispatchN
+    timer.start(PHASE_BUILD);
+    dispatchN(n, [&](auto nc) {
         #pragma omp parallel
         {
-            // Collect edges for this thread using a fixed-size array
-            const int MAX_EDGES_PER_THREAD = 100000; 
-            uint32_t* temp_edges = new uint32_t[MAX_EDGES_PER_THREAD * 2];
-            int edge_count = 0;
+            uint8_t swapPos[PARENT_BATCH];
+            uint64_t parentRank[PARENT_BATCH];
+            vector<uint8_t> buf(rank==0 || pipeline ? 0 : CHUNK_ITEMS / 2);
+            PutRing ring(rank==0 || !pipeline ? 0 : PIPELINE_DEPTH, CHUNK_ITEMS / 2);
             
-            #pragma omp for schedule(guided, 1024)
-            for(size_t vIdx=0; vIdx<N; ++vIdx) {
-                if((int)vIdx == rootIdx) continue;
-                
-                // Find parent
-                vector<uint8_t> p = parent1(vIdx, t, n);
-                
-                // Optimize lookup
-                bool is_root = (p == root);
-                int pIdx;
-                
-                if (is_root) {
-                    pIdx = rootIdx;
-                } else {
-                    pIdx = indexOf[permToString(p)];
+            // Every thread pulls chunks from this process's queue, then steals
+            while (true) {
+                int64_t c;
+                bool stolen = false;
+                {
+                    CommWait wait;
+                    #pragma omp critical(mpi)
+                    c = sched.next(stolen);
                 }
+                if (c < 0) break;
                 
-                // Store edge in thread-local buffer
-                if(pIdx >= 0 && edge_count < MAX_EDGES_PER_THREAD) {
-                    temp_edges[edge_count*2] = pIdx; 
-                    temp_edges[edge_count*2+1] = vIdx;
-                    edge_count++;
+                // A chunk is a contiguous byte range of the forest: the master
+                // writes it in place, workers into a buffer that is then Put
+                uint64_t lo = sched.chunkBegin(c), hi = sched.chunkEnd(c);
+                uint8_t* chunkOut = (rank == 0) ? forest.itemBytes(lo) : buf.data();
+                if (pipeline && rank != 0) {
+                    CommWait wait;
+                    chunkOut = ring.acquire();
                 }
-            }
-            
-            // Process collected edges
-            vector<pair<uint32_t, uint32_t>> thread_edges;
-            thread_edges.reserve(edge_count);
-            for(int i = 0; i < edge_count; i++) {
-                thread_edges.emplace_back(temp_edges[i*2], temp_edges[i*2+1]);
-            }
-            
-            delete[] temp_edges;
-            
-            // Add edges to global collection with minimal critical section
-            #pragma omp critical
-            {
-                for(const auto& edge : thread_edges) {
-                    children_t[edge.first].push_back(edge.second);
+                
+                for (const Tile& tile : rangeTiles(n, lo, hi)) {
+                    uint64_t first = (uint64_t)(tile.t-1) * N + tile.vBegin;
+                    uint8_t* out = chunkOut + ((first - lo) >> 1);
+                    if (gray) {
+                        grayFillRange(rules, tile.t, nc, tile.vBegin, tile.vEnd, out, rootIdx);
+                        continue;
+                    }
+                    
+                    // One step = PARENT_BATCH consecutive vertices; whole bytes
+                    // are written, so no locking is needed
+                    for (uint64_t vBase = tile.vBegin; vBase < tile.vEnd; vBase += PARENT_BATCH) {
+                        int count = (int)min<uint64_t>(PARENT_BATCH, tile.vEnd - vBase);
+                        const PackedPerm* src = implicit ? nullptr : perms + vBase;
+                        batchParents(rules, tile.t, nc, vBase, count, src, swapPos, parentRank);
+                        packSwapBatch(out + ((vBase - tile.vBegin) >> 1), vBase, count, swapPos, rootIdx);
+                    }
                 }
-            }
-        }
-        
-        cout << "Process " << rank << " completed tree " << t << endl;
-        
-        // If master process, store directly, else send to master
-        if(rank==0) {
-            children_global[t-1] = move(children_t);
-        } else {
-            // Serialize edges into a flat buffer to send
-            size_t total_edges = 0;
-            for(uint32_t p=0; p<N; ++p) {
-                total_edges += children_t[p].size();
-            }
-            
-            // Only send if there are edges to send
-            if (total_edges > 0) {
-                // Create buffer with exact size needed
-                vector<uint32_t> buf;
-                buf.reserve(total_edges * 2 + 1);
                 
-                // First value is the tree ID
-                buf.push_back(t);
+                int bytes = (int)((hi - lo) >> 1);
+                if (pipeline && rank != 0) {
+                    // Returns at once; the slot is reused only after it completes
+                    ring.put(bytes, 0, (MPI_Aint)(lo >> 1), resultWin);
+                }
                 
-                // Flatten edge list
-                for(uint32_t p=0; p<N; ++p) {
-                    for(auto c: children_t[p]) {
-                        buf.push_back(p);
-                        buf.push_back(c);
+                CommWait wait;
+                #pragma omp critical(mpi)
+                {
+                    chunksDone++;
+                    if (stolen) chunksStolen++;
+                    if (rank != 0 && !pipeline) {
+                        // Write the chunk straight to its offset on the master;
+                        // the flush lets this thread reuse its buffer
+                        MPI_Put(buf.data(), bytes, MPI_BYTE, 0, (MPI_Aint)(lo >> 1), bytes, MPI_BYTE, resultWin);
+                        MPI_Win_flush(0, resultWin);
                     }
                 }
-                
-                // Send to master
-                MPI_Request req;
-                MPI_Isend(buf.data(), buf.size(), MPI_UINT32_T, 0, t, MPI_COMM_WORLD, &req);
-                sendRequests.push_back(req);
-                sendBuffers.push_back(move(buf));
-                cout << "Process " << rank << " sent tree " << t << " to master" << endl;
-            } else {
-                // Send empty message to indicate completion
-                vector<uint32_t> buf(1, t);
-                MPI_Request req;
-                MPI_Isend(buf.data(), buf.size(), MPI_UINT32_T, 0, t, MPI_COMM_WORLD, &req);
-                sendRequests.push_back(req);
-                sendBuffers.push_back(move(buf));
-                cout << "Process " << rank << " sent empty tree " << t << " to master" << endl;
+            }
+            
+            // Local completion of this thread's last puts
+            if (pipeline && rank != 0) {
+                CommWait wait;
+                ring.drain();
             }
         }
+    });
+    progress.reset();
+    timer.stop();
+    
+    cout << "Process " << rank << " built " << chunksDone << " chunks (" << chunksStolen
+         << " stolen)" << endl;
+    
+    // Collective: completes every Put into the master's forest and frees the
+    // result and queue windows
+    timer.start(PHASE_GATHER);
+    if (resultWin != MPI_WIN_NULL) {
+        CommWait wait;
+        MPI_Win_unlock_all(resultWin);
+        MPI_Win_free(&resultWin);
     }
-
-    // Wait for all sends to complete
-    if(!sendRequests.empty()) {
-        MPI_Waitall(sendRequests.size(), sendRequests.data(), MPI_STATUSES_IGNORE);
-    }
+    sched.close();
     
-    // Master process: receive trees from other processes
+    timer.start(PHASE_EXPORT);
+    int written = 1;
     if(rank==0) {
-        // Set of trees we need to receive
-        set<int> treesNeeded;
-        for (int t = 1; t <= T; t++) {
-            if (t % size != 0) {  // Only need trees not built by master
-                treesNeeded.insert(t);
-            }
-        }
-        
-        cout << "Master needs to receive " << treesNeeded.size() << " trees" << endl;
-        
-        // While there are still trees to receive
-        while (!treesNeeded.empty()) {
-            MPI_Status status;
-            int flag = 0;
-            
-            // Check for any incoming message
-            MPI_Iprobe(MPI_ANY_SOURCE, MPI_ANY_TAG, MPI_COMM_WORLD, &flag, &status);
-            
-            if (flag) {
-                // Get message size
-                int count;
-                MPI_Get_count(&status, MPI_UINT32_T, &count);
-                
-                // Receive the message
-                vector<uint32_t> buffer(count);
-                MPI_Recv(buffer.data(), count, MPI_UINT32_T, 
-                         status.MPI_SOURCE, status.MPI_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-                
-                // Extract tree ID (first element)
-                int tree_id = buffer[0];
-                
-                if (count > 1) {
-                    // Process the edges (rest of buffer)
-                    for (int i = 1; i < count; i += 2) {
-                        int p = buffer[i];
-                        int c = buffer[i+1];
-                        if (p >= 0 && p < (int)N && c >= 0 && c < (int)N) {
-                            children_global[tree_id-1][p].push_back(c);
-                        }
-                    }
-                    cout << "Master received tree " << tree_id << " with " 
-                         << (count-1)/2 << " edges from process " << status.MPI_SOURCE << endl;
-                } else {
-                    // Empty tree
-                    cout << "Master received empty tree " << tree_id 
-                         << " from process " << status.MPI_SOURCE << endl;
-                }
-                
-                // Mark tree as received
-                treesNeeded.erase(tree_id);
+        // All trees received; chunks are assembled on the master, so it is
+        // the single writer of the Tn_t.mist files
+        for(int t=1; t<=T; ++t)
+            if(!writeMistFile(mistFilePath(cacheDir, t), forest.tree(t), t)) {
+                cerr<<"Cannot write "<<mistFilePath(cacheDir, t)<<"\n";
+                written = 0;
             }
-        }
-        
-        // All trees received, write DOT files
-        /*
-        cout << "Writing DOT files..." << endl;
-        for(int t=1; t<=T; ++t) {
-            ofstream dot("Tn_"+to_string(t)+".dot");
-            dot<<"digraph T"<<n<<"_"<<t<<" {\n  rankdir=TB;\n";
-            for(uint32_t p=0; p<N; ++p)
-                for(auto c: children_global[t-1][p])
-                    dot<<"  \""<<permToString(perms[p])<<"\" -> \""
-                       <<permToString(perms[c])<<"\";\n";
-            dot<<"}\n";
-        }
-            */
     }
 
     // Ensure all processes are done before reporting time
-    MPI_Barrier(MPI_COMM_WORLD);
+    timer.stop();
+    {
+        CommWait wait;
+        MPI_Barrier(MPI_COMM_WORLD);
+    }
     double t_end = MPI_Wtime();
     if(rank==0) cout<<"Total execution time: "<< (t_end - t_start) <<" seconds\n";
+
+    MPI_Bcast(&written, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    bool ok = written != 0;
+    if(verify) {
+        vector<PackedTree> trees;
+        if(rank==0) for(int t=1; t<=T; ++t) trees.push_back(forest.tree(t));
+        timer.start(PHASE_VERIFY);
+        ok = verifyForest(trees, n, rank) && ok;
+    }
+    printPhasesMPI(timer, MPI_COMM_WORLD, cout);
+    printInstrumentMPI(rules, MPI_COMM_WORLD, cout);
+    vertexTable.close();
     MPI_Finalize();
-    return 0;
+    return ok ? 0 : 1;
 }
\ No newline at end of file
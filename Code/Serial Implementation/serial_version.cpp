@@ -1,143 +1,220 @@
 #include <iostream>
 #include <bits/stdc++.h>
 #include <cstdint>
+#include "../Common/perm_rank.h"
+#include "../Common/packed_perm.h"
+#include "../Common/ist_rules.h"
+#include "../Common/rule_table.h"
+#include "../Common/dispatch_n.h"
+#include "../Common/batch_kernel.h"
+#include "../Common/gray_kernel.h"
+#include "../Common/mist_stream.h"
+#include "../Common/mist_checkpoint.h"
+#include "../Common/packed_tree.h"
+#include "../Common/perm_gen.h"
+#include "../Common/mist_format.h"
+#include "../Common/mist_mmap.h"
+#include "../Common/mist_cache.h"
+#include "../Common/ist_verify.h"
+#include "../Common/phase_timer.h"
+#include "../Common/instrument.h"
 using namespace std;
 
-static vector< vector<uint8_t> > perms;      // all vertices, each permutation symbol in [1..n]
-static vector< vector<uint8_t> > pos;        // pos[v][symbol] = index of symbol in perms[v]
-static vector<uint8_t> firstWrong;           // firstWrong[v] = first wrong-from-right position, 1-based
-static vector<uint8_t> root;                 // identity permutation [1..n]
-
-vector< vector<uint8_t> > generatePermutations(int n) {
-    vector<uint8_t> base(n);
-    iota(base.begin(), base.end(), 1);
-    vector<vector<uint8_t>> all;
-    do all.push_back(base);
-    while(next_permutation(base.begin(), base.end()));
-    return all;
+static vector<PackedPerm> perms;             // all vertices, 4 bits per symbol
+static PackedPerm root;                      // identity permutation [1..n]
+
+// Checks that the trees are spanning and independent; false on failure.
+bool verifyForest(const vector<PackedTree>& trees, int n) {
+    double start = wallSeconds();
+    VerifyReport rep;
+    dispatchN(n, [&](auto nc) { rep = verifyTrees(trees, nc, 0, FACT[n]); });
+    cout << "Verify (" << wallSeconds() - start << " s):\n";
+    printVerifyReport(rep, cout);
+    return rep.ok();
 }
 
-string permToString(const vector<uint8_t>& p) {
-    string s;
-    s.reserve(p.size());
-    for (uint8_t x : p) s.push_back(char('0' + x));
-    return s;
-}
-
-
-
-void preprocess(int n) {
-    size_t N = perms.size();
-    for (size_t v = 0; v < N; ++v) {
-        auto &P = perms[v];
-        for (int j = 0; j < n; ++j)
-            pos[v][ P[j] ] = (uint8_t)j;
-            int r;
-            for (r = n - 1; r >= 0; --r) if (P[r] != r+1) break;
-        firstWrong[v] = (r <= 0 ? 1 : (uint8_t)r);
-    }
-}
-
-vector<uint8_t> swapAdjacent(size_t vIdx, uint8_t symbol) {
-    auto v = perms[vIdx];
-    int j = pos[vIdx][symbol];
-    if (j < 0 || j + 1 >= (int)v.size()) return v;
-    swap(v[j], v[j+1]);
-    return v;
-}
-
-vector<uint8_t> findPosition(size_t vIdx, int t, int n) {
-    auto v = perms[vIdx];
-    auto u = swapAdjacent(vIdx, (uint8_t)t);
-    if (t == 2 && u == root) return swapAdjacent(vIdx, (uint8_t)(t-1));
-    uint8_t vn1 = v[n-2];
-    if (vn1 == t || vn1 == n-1) return swapAdjacent(vIdx, (uint8_t)(firstWrong[vIdx] + 1));
-    return u;
-}
-
-vector<uint8_t> parent1(size_t vIdx, int t, int n) {
-    auto v = perms[vIdx];
-    uint8_t vn = v[n-1], vn1 = v[n-2];
-    if (vn == n) {
-        return (t != n-1 ? findPosition(vIdx, t, n)
-                         : swapAdjacent(vIdx, vn1));
+int main(int argc, char** argv) {
+    // --implicit: unrank each vertex on the fly instead of building the perms table
+    // --gray: walk the vertices in Gray-code order with O(1) updates (no perms table)
+    // --stream: build block by block straight to the files, in bounded memory (n <= 14)
+    // --resume: --stream, skipping the blocks the last run's checkpoint records
+    // --checkpoint <s>: seconds between --stream checkpoints
+    // --cache <dir>: reuse the trees cached for this n, else build and cache them
+    // --verify: check the trees are spanning and independent (exit code 1 if not)
+    bool implicit = false, gray = false, stream = false, resume = false, verify = false, badArgs = (argc < 2);
+    double checkpointSeconds = CHECKPOINT_SECONDS;
+    string cacheRoot;
+    for (int i = 2; i < argc; i++) {
+        string a = argv[i];
+        if (a == "--implicit") implicit = true;
+        else if (a == "--gray") gray = true;
+        else if (a == "--stream") stream = true;
+        else if (a == "--resume") stream = resume = true;
+        else if (a == "--checkpoint" && i + 1 < argc) checkpointSeconds = stod(argv[++i]);
+        else if (a == "--cache" && i + 1 < argc) cacheRoot = argv[++i];
+        else if (a == "--verify") verify = true;
+        else badArgs = true;
     }
-    if (vn == n-1 && vn1 == n && swapAdjacent(vIdx, (uint8_t)n) != root) {
-        return (t == 1 ? swapAdjacent(vIdx, (uint8_t)n)
-                       : swapAdjacent(vIdx, (uint8_t)(t-1)));
+    if (badArgs) {
+        cerr << "Usage: " << argv[0] << " <n> [--implicit] [--gray] [--stream] [--resume] [--checkpoint <s>]"
+                " [--cache <dir>] [--verify]\n";
+        return 1;
     }
-    return (vn == t ? swapAdjacent(vIdx, (uint8_t)n)
-                    : swapAdjacent(vIdx, (uint8_t)t));
-}
-
-int main(int argc, char** argv) {
-    if (argc != 2) {
-        cerr << "Usage: " << argv[0] << " <n (2<=n<=10)>\n";
+    if (stream && verify) {
+        cerr << "--verify needs the trees in memory and cannot be used with --stream\n";
         return 1;
     }
+    implicit = implicit || gray || stream;
     int n = stoi(argv[1]);
-    if (n < 2 || n > 10) {
-        cerr << "n must be in range [2..10]\n";
+    int maxN = stream ? MAX_STREAM_N : implicit ? MAX_IMPLICIT_N : MAX_TABLE_N;
+    if (n < 2 || n > maxN) {
+        cerr << "n must be in range [2.." << maxN << "]\n";
         return 1;
     }
-    clock_t start = clock();
-    // Generate and store all permutations of size n
-    perms = generatePermutations(n);
-    int N = perms.size();
-
-    // Prepare identity root globally
-    root.resize(n);
-    iota(root.begin(), root.end(), static_cast<uint8_t>(1));
-
-    // Preprocess per-vertex information
-    pos.assign(N, vector<uint8_t>(n+1));
-    firstWrong.assign(N, static_cast<uint8_t>(1));
-    preprocess(n);
-
-    // Map permutation string to index for lookup
-    unordered_map<string, int> indexOf;
-    indexOf.reserve(N);
-    for (int i = 0; i < N; i++) {
-        indexOf[ permToString(perms[i]) ] = i;
+    PhaseTimer timer;
+    uint64_t N = FACT[n];
+
+    // A cache hit maps the stored trees instead of building them
+    string cacheDir = cacheRoot.empty() ? "" : mistCacheDir(cacheRoot, n);
+    if (!cacheDir.empty()) {
+        MappedForest cached;
+        string err;
+        timer.start(PHASE_LOAD);
+        if (cached.open(cacheDir, n, err)) {
+            timer.stop();
+            cout << "Loaded " << n-1 << " trees from " << cacheDir << endl;
+            cout << "Time : " << timer.total() << endl;
+            bool ok = true;
+            if (verify) {
+                vector<PackedTree> trees;
+                for (int t = 1; t <= n-1; t++) trees.push_back(cached.tree(t));
+                timer.start(PHASE_VERIFY);
+                ok = verifyForest(trees, n);
+                timer.stop();
+            }
+            printPhases(timer.seconds, timer.total(), cout);
+            return ok ? 0 : 1;
+        }
+        if (!makeMistCacheDir(cacheDir)) {
+            cerr << "Cannot create " << cacheDir << "\n";
+            return 1;
+        }
     }
 
-    // Prepare children lists: children[t][pIdx] -> list of child indices
-    vector<vector<vector<int>>> children(n-1, vector<vector<int>>(N));
-
-    // Identify root index (identity permutation)
-    int rootIndex = indexOf[ permToString(root) ];
-
-    // Build all trees using precomputed structures
-    for (uint8_t t = 1; t <= n-1; t++) {
-        for (int vIdx = 0; vIdx < N; vIdx++) {
-            if (vIdx == rootIndex) continue;
-            vector<uint8_t> pVec = parent1(vIdx, t, n);
-            int pIdx = indexOf[ permToString(pVec) ];
-            children[t-1][pIdx].push_back(vIdx);
+    // Prepare identity root globally
+    root = PackedPerm::identity(n);
+
+    // Vertex index == lexicographic rank, so the identity root is vertex 0
+    uint64_t rootIndex = rankPacked(root, n);
+
+    // Out of core: build STREAM_BLOCK vertices of every tree, write them to
+    // the files, and reuse the buffers for the next block. Every
+    // checkpointSeconds the files are synced and the finished blocks saved
+    // to the checkpoint; --resume builds only the blocks it does not record.
+    if (stream) {
+        timer.start(PHASE_PREPROCESS);
+        RuleTable rules(n);
+        StreamBlockBuilder builder(n, gray);
+        uint64_t blocks = streamBlockCount(n);
+        StreamCheckpoint checkpoint(n, STREAM_BLOCK, blocks);
+        string checkpointFile = checkpointPath(cacheDir);
+        string err;
+        bool keep = resume && checkpoint.load(cacheDir, err);
+        if (keep) cout << "Resuming: " << checkpoint.doneCount() << " of " << blocks << " blocks already written" << endl;
+        else if (resume) cout << "Starting over: " << err << endl;
+        if (!keep) remove(checkpointFile.c_str());   // stale once the files are truncated
+        MistStreamWriter writer;
+        bool ok = writer.open(n, cacheDir, keep);
+        vector<uint64_t> todo = checkpoint.pending();
+        cout << "Streaming " << N << " vertices in " << blocks << " blocks" << endl;
+        double lastCheckpoint = wallSeconds();
+        for (size_t i = 0; i < todo.size() && ok; i++) {
+            uint64_t lo, hi;
+            streamBlockRange(n, todo[i], lo, hi);
+            timer.start(PHASE_BUILD);
+            size_t bytes = 0;
+            dispatchN(n, [&](auto nc) { bytes = builder.build(rules, nc, lo, hi, rootIndex); });
+            timer.start(PHASE_EXPORT);
+            for (int t = 1; t <= n-1 && ok; t++) ok = writer.write(t, lo / 2, builder.out[t-1].data(), bytes);
+            if (!ok) break;
+            checkpoint.markDone(todo[i]);
+            if (ok && wallSeconds() - lastCheckpoint >= checkpointSeconds) {
+                ok = writer.sync();
+                if (ok && !checkpoint.save(cacheDir)) cerr << "Cannot write " << checkpointFile << "\n";
+                lastCheckpoint = wallSeconds();
+            }
+            if ((i + 1) * 10 / todo.size() != i * 10 / todo.size())
+                cout << "  " << (i + 1) * 100 / todo.size() << "% (" << i + 1 << " blocks)" << endl;
+        }
+        ok = writer.finish(ok) && ok;
+        timer.stop();
+        if (!ok) {
+            cerr << "Cannot write the tree files\n";
+            return 1;
         }
+        remove(checkpointFile.c_str());             // the headers now mark the files complete
+        cout << "Time : " << timer.total() << endl;
+        printPhases(timer.seconds, timer.total(), cout);
+        printInstrumentReport(rules, cout);
+        return 0;
     }
 
-    clock_t end = clock();
-    double time = (double)(end-start)/CLOCKS_PER_SEC;
-    cout<<"Time : "<<time<<endl;
-
-    /*
-
-    // Export to DOT files
-    for (uint8_t t = 1; t <= n-1; t++) {
-        string fname = "Tn_" + to_string(t) + ".dot";
-        ofstream dot(fname);
-        dot << "digraph T" << n << "_" << static_cast<int>(t) << " {\n  rankdir=TB;\n";
-        for (int pIdx = 0; pIdx < N; pIdx++) {
-            string pLabel = permToString(perms[pIdx]);
-            for (int c : children[t-1][pIdx]) {
-                string cLabel = permToString(perms[c]);
-                dot << "  \"" << pLabel << "\" -> \"" << cLabel << "\";\n";
+    // Generate and store all permutations of size n
+    timer.start(PHASE_GENERATE);
+    if (!implicit) perms = generatePermRange(n, 0, N);
+
+    // All n-1 trees, a 4-bit swap position per vertex
+    timer.start(PHASE_PREPROCESS);
+    PackedForest forest(n);
+
+    // Parent rules compiled into a lookup table for this n
+    RuleTable rules(n);
+
+    // Build all trees from the table, or from vertices unranked on the fly;
+    // dispatchN instantiates the loop for the concrete n, and parents are
+    // computed PARENT_BATCH vertices at a time by the SIMD batch kernel
+    timer.start(PHASE_BUILD);
+    dispatchN(n, [&](auto nc) {
+        if (gray) {
+            for (int t = 1; t <= n-1; t++) grayFillRange(rules, t, nc, 0, N, forest.tree(t).bytes, rootIndex);
+            return;
+        }
+        uint8_t swapPos[PARENT_BATCH];
+        uint64_t parentRank[PARENT_BATCH];
+        for (uint8_t t = 1; t <= n-1; t++) {
+            for (uint64_t vBase = 0; vBase < N; vBase += PARENT_BATCH) {
+                int count = (int)min<uint64_t>(PARENT_BATCH, N - vBase);
+                batchParents(rules, t, nc, vBase, count, implicit ? nullptr : perms.data() + vBase,
+                             swapPos, parentRank);
+                forest.tree(t).storeBatch(vBase, count, swapPos, rootIndex);
             }
         }
-        dot << "}\n";
+    });
+
+    timer.stop();
+    cout<<"Time : "<<timer.total()<<endl;
+
+    // Export each tree as Tn_t.mist (packed bytes plus a header); DOT or
+    // GraphML can be produced from these with Tools/mist_convert
+    timer.start(PHASE_EXPORT);
+    for (int t = 1; t <= n-1; t++) {
+        if (!writeMistFile(mistFilePath(cacheDir, t), forest.tree(t), t)) {
+            cerr << "Cannot write " << mistFilePath(cacheDir, t) << "\n";
+            return 1;
+        }
+    }
+
+    bool ok = true;
+    if (verify) {
+        vector<PackedTree> trees;
+        for (int t = 1; t <= n-1; t++) trees.push_back(forest.tree(t));
+        timer.start(PHASE_VERIFY);
+        ok = verifyForest(trees, n);
     }
-        */
-    return 0;
+    timer.stop();
+    printPhases(timer.seconds, timer.total(), cout);
+    printInstrumentReport(rules, cout);
+
+    return ok ? 0 : 1;
 }
 
@@ -0,0 +1,77 @@
+#include <bits/stdc++.h>
+#include "../Common/packed_perm.h"
+#include "../Common/packed_tree.h"
+#include "../Common/tree_layout.h"
+#include "../Common/mist_format.h"
+#include "../Common/mist_mmap.h"
+#include "../Common/relabel.h"
+#include "vertex_arg.h"
+using namespace std;
+
+// Converts a Tn_t.mist tree file to DOT (default) or GraphML. The file is
+// mapped and its packed bytes are used in place as a PackedTree; the edges come from the CSR
+// children index, so the DOT output matches what the programs used to write.
+// --root r writes the same tree rooted at r instead of the identity: every
+// vertex u is relabeled to r∘u (see relabel.h), nothing is rebuilt.
+
+static const int MAX_CONVERT_N = 10;             // text output is n!·~30 bytes
+
+int main(int argc, char** argv) {
+    string in, out, format = "dot", rootArg;
+    bool badArgs = (argc < 2);
+    for (int i = 1; i < argc; ++i) {
+        string a = argv[i];
+        if (a == "--dot") format = "dot";
+        else if (a == "--graphml") format = "graphml";
+        else if (a == "-o" && i + 1 < argc) out = argv[++i];
+        else if (a == "--root" && i + 1 < argc) rootArg = argv[++i];
+        else if (in.empty() && a[0] != '-') in = a;
+        else badArgs = true;
+    }
+    if (badArgs || in.empty()) {
+        cerr << "Usage: " << argv[0] << " <file.mist> [--dot|--graphml] [--root <vertex>] [-o out]\n"
+             << "  vertex: rank, or symbols s1,s2,...,sn\n";
+        return 1;
+    }
+
+    MappedTree mapped;
+    string err;
+    if (!mapped.open(in, err)) { cerr << in << ": " << err << "\n"; return 1; }
+    int n = (int)mapped.header().n, t = (int)mapped.header().t;
+    if (n > MAX_CONVERT_N) { cerr << in << ": n=" << n << " is too large for text output\n"; return 1; }
+
+    PackedPerm root = PackedPerm::identity(n);
+    if (!rootArg.empty() && !parseVertexArg(rootArg, n, root, err)) { cerr << err << "\n"; return 1; }
+
+    // edges of the identity-rooted tree; relabeling only changes the labels
+    PackedTree tree = mapped.tree();
+    ChildrenCSR csr = buildChildrenCSR(parentArray(tree, nullptr, n));
+    vector<string> label(tree.N);
+    for (uint64_t v = 0; v < tree.N; ++v) label[v] = permToString(composeSymbols(root, unrankPacked(v, n), n), n);
+
+    if (out.empty()) {
+        string base = in.size() > 5 && in.compare(in.size() - 5, 5, ".mist") == 0 ? in.substr(0, in.size() - 5) : in;
+        out = base + "." + format;
+    }
+    ofstream f(out);
+    if (!f) { cerr << "Cannot write " << out << "\n"; return 1; }
+
+    if (format == "dot") {
+        f << "digraph T" << n << "_" << t << " {\n  rankdir=TB;\n";
+        for (uint64_t p = 0; p < tree.N; ++p)
+            for (const uint32_t* c = csr.begin(p); c != csr.end(p); ++c)
+                f << "  \"" << label[p] << "\" -> \"" << label[*c] << "\";\n";
+        f << "}\n";
+    } else {
+        f << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+          << "<graphml xmlns=\"http://graphml.graphdrawing.org/xmlns\">\n"
+          << "  <graph id=\"T" << n << "_" << t << "\" edgedefault=\"directed\">\n";
+        for (uint64_t v = 0; v < tree.N; ++v)
+            f << "    <node id=\"" << label[v] << "\"/>\n";
+        for (uint64_t p = 0; p < tree.N; ++p)
+            for (const uint32_t* c = csr.begin(p); c != csr.end(p); ++c)
+                f << "    <edge source=\"" << label[p] << "\" target=\"" << label[*c] << "\"/>\n";
+        f << "  </graph>\n</graphml>\n";
+    }
+    return 0;
+}
@@ -0,0 +1,50 @@
+#include <bits/stdc++.h>
+#include "../Common/packed_perm.h"
+#include "../Common/ist_query.h"
+#include "vertex_arg.h"
+using namespace std;
+
+// Path-to-root queries straight from the rules (ist_query.h); nothing is
+// built or loaded, so any n up to 16 answers at once. Prints the path from
+// the vertex to the root in tree t, or in every tree when t is omitted.
+// Vertices are ranks, or permutations given as comma-separated symbols; with
+// --root the trees are rooted at that vertex instead of the identity.
+
+int main(int argc, char** argv) {
+    vector<string> pos;
+    string rootArg;
+    for (int i = 1; i < argc; ++i) {
+        string a = argv[i];
+        if (a == "--root" && i + 1 < argc) rootArg = argv[++i];
+        else pos.push_back(a);
+    }
+    if (pos.size() != 2 && pos.size() != 3) {
+        cerr << "Usage: " << argv[0] << " <n> <vertex> [t] [--root <vertex>]\n"
+             << "  vertex: rank, or symbols s1,s2,...,sn\n";
+        return 1;
+    }
+    int n = stoi(pos[0]);
+    if (n < 2 || n > MAX_QUERY_N) { cerr << "n must be in range [2.." << MAX_QUERY_N << "]\n"; return 1; }
+
+    string err;
+    PackedPerm pv, root = PackedPerm::identity(n);
+    if (!parseVertexArg(pos[1], n, pv, err) || (!rootArg.empty() && !parseVertexArg(rootArg, n, root, err))) {
+        cerr << err << "\n";
+        return 1;
+    }
+    IstQuery q(n, root);
+    uint64_t v = q.rank(pv);
+
+    int tLo = 1, tHi = n - 1;
+    if (pos.size() == 3) tLo = tHi = stoi(pos[2]);
+    if (tLo < 1 || tHi > n - 1) { cerr << "t must be in range [1.." << n-1 << "]\n"; return 1; }
+
+    for (int t = tLo; t <= tHi; ++t) {
+        vector<uint64_t> path = q.pathToRoot(t, v);
+        if (path.empty()) { cout << "T" << t << ": does not reach the root\n"; continue; }
+        cout << "T" << t << " (" << path.size() - 1 << " edges):";
+        for (uint64_t u : path) cout << " " << permToString(q.perm(u), n, true);
+        cout << "\n";
+    }
+    return 0;
+}
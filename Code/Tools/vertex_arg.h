@@ -0,0 +1,29 @@
+#pragma once
+// Command-line vertex: a lexicographic rank, or a permutation given as
+// comma-separated symbols ("3,1,2").
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../Common/perm_rank.h"
+#include "../Common/packed_perm.h"
+
+inline bool parseVertexArg(const std::string& arg, int n, PackedPerm& v, std::string& err) {
+    if (arg.find(',') == std::string::npos) {
+        uint64_t r = std::stoull(arg);
+        if (r >= FACT[n]) { err = "rank must be below " + std::to_string(FACT[n]); return false; }
+        v = unrankPacked(r, n);
+        return true;
+    }
+    std::vector<uint8_t> p;
+    std::stringstream ss(arg);
+    for (std::string tok; std::getline(ss, tok, ',');) p.push_back((uint8_t)std::stoi(tok));
+    std::vector<uint8_t> sorted = p;
+    std::sort(sorted.begin(), sorted.end());
+    bool ok = (int)p.size() == n;
+    for (int j = 0; ok && j < n; ++j) ok = (sorted[j] == j + 1);
+    if (!ok) { err = arg + " is not a permutation of 1.." + std::to_string(n); return false; }
+    v = packPerm(p.data(), n);
+    return true;
+}